@@ -0,0 +1,284 @@
+#include "archive.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const uint32_t Archive::magic;
+const uint32_t Archive::version;
+const uint32_t Archive::alignment;
+
+static const int headerSize = 16;
+static const int minMatch = 4;
+static const int hashBits = 14;
+
+static void writeLength(std::vector<uint8_t> &out, size_t length) {
+	for (length -= 15; length >= 255; length -= 255) out.push_back(255);
+	out.push_back((uint8_t) length);
+}
+
+static bool readLength(const uint8_t *in, size_t inSize, size_t &i, size_t &length) {
+	uint8_t byte;
+	do {
+		if (i >= inSize) return false;
+		byte = in[i++];
+		length += byte;
+	} while (byte == 255);
+	return true;
+}
+
+/// A token byte (literal count and match length - 4, 15 meaning more length bytes follow), the literals, then a 2 byte match offset.
+/// The last sequence only has literals
+static void writeSequence(std::vector<uint8_t> &out, const uint8_t *literals, size_t literalCount, size_t offset, size_t matchLength) {
+	size_t matchCode = matchLength > 0 ? matchLength - minMatch : 0;
+	out.push_back((uint8_t) (std::min<size_t>(literalCount, 15) << 4 | std::min<size_t>(matchCode, 15)));
+	if (literalCount >= 15) writeLength(out, literalCount);
+	out.insert(out.end(), literals, literals + literalCount);
+
+	if (matchLength == 0) return;
+
+	out.push_back((uint8_t) offset);
+	out.push_back((uint8_t) (offset >> 8));
+	if (matchCode >= 15) writeLength(out, matchCode);
+}
+
+/// Greedy LZ77 with a single hash table slot per 4 byte sequence, within a 64KB window
+static std::vector<uint8_t> compress(const uint8_t *in, size_t size) {
+	std::vector<uint8_t> out;
+	std::vector<int64_t> table(1 << hashBits, -1);
+	size_t literalStart = 0, i = 0;
+
+	while (i + minMatch <= size) {
+		uint32_t sequence;
+		memcpy(&sequence, in + i, minMatch);
+		uint32_t hash = (sequence * 2654435761u) >> (32 - hashBits);
+
+		int64_t candidate = table[hash];
+		table[hash] = (int64_t) i;
+
+		if (candidate < 0 || i - candidate > 65535 || memcmp(in + candidate, in + i, minMatch) != 0) {
+			i++;
+			continue;
+		}
+
+		size_t matchLength = minMatch;
+		while (i + matchLength < size && in[candidate + matchLength] == in[i + matchLength]) matchLength++;
+
+		writeSequence(out, in + literalStart, i - literalStart, i - candidate, matchLength);
+		i += matchLength;
+		literalStart = i;
+	}
+
+	writeSequence(out, in + literalStart, size - literalStart, 0, 0);
+	return out;
+}
+
+static bool decompress(const uint8_t *in, size_t inSize, uint8_t *out, size_t outSize) {
+	size_t i = 0, o = 0;
+
+	while (i < inSize) {
+		uint8_t token = in[i++];
+
+		size_t literalCount = token >> 4;
+		if (literalCount == 15 && !readLength(in, inSize, i, literalCount)) return false;
+		if (literalCount > inSize - i || literalCount > outSize - o) return false;
+
+		memcpy(out + o, in + i, literalCount);
+		i += literalCount;
+		o += literalCount;
+
+		if (i == inSize) break;
+		if (inSize - i < 2) return false;
+
+		size_t offset = in[i] | in[i + 1] << 8;
+		i += 2;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !readLength(in, inSize, i, matchLength)) return false;
+		matchLength += minMatch;
+		if (offset == 0 || offset > o || matchLength > outSize - o) return false;
+
+		for (size_t n = 0; n < matchLength; n++, o++) out[o] = out[o - offset]; // Matches may overlap what they copy
+	}
+
+	return o == outSize;
+}
+
+Archive::Archive() {
+	data = NULL;
+	length = 0;
+	entries = NULL;
+	count = 0;
+}
+
+Archive::~Archive() {
+	close();
+}
+
+bool Archive::open(const char *path) {
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = NULL;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL) return false;
+
+	data = (const uint8_t*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping); // The view keeps the mapping alive
+	if (data == NULL) return false;
+	length = (size_t) fileSize.QuadPart;
+#else
+	int file = ::open(path, O_RDONLY);
+	if (file < 0) return false;
+
+	struct stat info;
+	void *view = MAP_FAILED;
+	if (fstat(file, &info) == 0 && info.st_size > 0) view = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file); // The mapping keeps the file open
+	if (view == MAP_FAILED) return false;
+
+	data = (const uint8_t*) view;
+	length = info.st_size;
+#endif
+
+	if (!validate()) {
+		printf("Error: \"%s\" is not a valid resource archive\n", path);
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void Archive::close() {
+	if (data != NULL) {
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+#else
+		munmap((void*) data, length);
+#endif
+	}
+
+	data = NULL;
+	length = 0;
+	entries = NULL;
+	count = 0;
+	unpacked.clear();
+}
+
+/// Checks every entry lies inside the file before anything is read through it, and unpacks the compressed ones
+bool Archive::validate() {
+	if (length < headerSize) return false;
+
+	uint32_t header[4];
+	memcpy(header, data, headerSize);
+	if (header[0] != magic || header[1] != version) return false;
+	if (header[2] > (length - headerSize) / sizeof(archiveEntry)) return false;
+
+	entries = (const archiveEntry*) (data + headerSize);
+	count = header[2];
+	unpacked.resize(count);
+
+	for (uint32_t n = 0; n < count; n++) {
+		const archiveEntry &entry = entries[n];
+		if (memchr(entry.name, 0, sizeof(entry.name)) == NULL) return false;
+		if (n > 0 && strcmp(entries[n - 1].name, entry.name) >= 0) return false;
+		if (entry.offset > length || entry.storedSize > length - entry.offset) return false;
+
+		if (entry.compression == LZ) {
+			unpacked[n].resize(entry.size);
+			if (!decompress(data + entry.offset, entry.storedSize, unpacked[n].data(), entry.size)) return false;
+		} else if (entry.compression != STORED || entry.size != entry.storedSize) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const uint8_t *Archive::find(const char *name, size_t &size) const {
+	const archiveEntry *end = entries + count;
+	const archiveEntry *entry = std::lower_bound(entries, end, name, [](const archiveEntry &e, const char *key) { return strcmp(e.name, key) < 0; });
+	if (entry == end || strcmp(entry->name, name) != 0) return NULL;
+
+	size = entry->size;
+	if (entry->compression == LZ) return unpacked[entry - entries].data();
+	return data + entry->offset;
+}
+
+bool Archive::write(const char *path, std::vector<archiveFile> files, bool compressWav) {
+	std::sort(files.begin(), files.end(), [](const archiveFile &a, const archiveFile &b) { return a.name < b.name; });
+
+	std::vector<archiveEntry> table(files.size());
+	std::vector<std::vector<uint8_t>> compressed(files.size());
+	uint64_t offset = headerSize + files.size() * sizeof(archiveEntry);
+
+	for (int n = 0; n < files.size(); n++) {
+		const archiveFile &file = files[n];
+		if (file.name.empty() || file.name.size() >= sizeof(table[n].name) || (n > 0 && file.name == files[n - 1].name)) {
+			printf("Error: \"%s\" is not a usable archive entry name (up to %i characters, no duplicates)\n", file.name.c_str(), (int) sizeof(table[n].name) - 1);
+			return false;
+		}
+
+		archiveEntry &entry = table[n];
+		memset(&entry, 0, sizeof(entry));
+		memcpy(entry.name, file.name.c_str(), file.name.size());
+		entry.size = entry.storedSize = (uint32_t) file.contents.size();
+		entry.compression = STORED;
+
+		bool wav = file.name.size() > 4 && file.name.compare(file.name.size() - 4, 4, ".wav") == 0;
+		if (compressWav && wav) {
+			compressed[n] = compress(file.contents.data(), file.contents.size());
+			if (compressed[n].size() <= file.contents.size() - file.contents.size() / 8) {
+				entry.storedSize = (uint32_t) compressed[n].size();
+				entry.compression = LZ;
+			} else {
+				compressed[n].clear();
+			}
+		}
+
+		offset = (offset + alignment - 1) / alignment * alignment;
+		entry.offset = offset;
+		offset += entry.storedSize;
+	}
+
+	FILE *out = fopen(path, "wb");
+	if (out == NULL) {
+		printf("Error: Failed to write archive \"%s\"\n", path);
+		return false;
+	}
+
+	uint32_t header[4] = {magic, version, (uint32_t) table.size(), 0};
+	fwrite(header, sizeof(header), 1, out);
+	if (!table.empty()) fwrite(table.data(), sizeof(archiveEntry), table.size(), out);
+
+	static const uint8_t padding[alignment] = {};
+	uint64_t position = headerSize + table.size() * sizeof(archiveEntry);
+
+	for (int n = 0; n < files.size(); n++) {
+		fwrite(padding, 1, table[n].offset - position, out);
+		const std::vector<uint8_t> &stored = table[n].compression == LZ ? compressed[n] : files[n].contents;
+		if (!stored.empty()) fwrite(stored.data(), 1, stored.size(), out);
+		position = table[n].offset + table[n].storedSize;
+	}
+
+	bool written = ferror(out) == 0;
+	fclose(out);
+	return written;
+}
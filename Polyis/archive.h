@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct archiveEntry {
+	char name[40]; // NUL terminated
+	uint64_t offset;
+	uint32_t storedSize, size;
+	uint32_t compression;
+	uint32_t reserved;
+};
+
+struct archiveFile {
+	std::string name;
+	std::vector<uint8_t> contents;
+};
+
+/// Read only view of a resource archive: a header, a table of entries sorted by name, then each entry's data starting on an alignment boundary.
+/// The file is memory mapped, so uncompressed entries are used in place
+class Archive {
+public:
+	enum compressionType {
+		STORED,
+		LZ
+	};
+
+	static const uint32_t magic = 0x50594C50; // "PLYP"
+	static const uint32_t version = 1;
+	static const uint32_t alignment = 64;
+
+	Archive();
+	~Archive();
+
+	bool open(const char *path);
+	void close();
+
+	/// Contents of the named entry, or NULL if the archive has no such entry. Stays valid until close()
+	const uint8_t *find(const char *name, size_t &size) const;
+
+	/// Packs files into a new archive. With compressWav, WAV files are stored LZ compressed when that makes them at least an eighth smaller
+	static bool write(const char *path, std::vector<archiveFile> files, bool compressWav);
+
+private:
+	const uint8_t *data;
+	size_t length;
+	const archiveEntry *entries;
+	uint32_t count;
+
+	/// Compressed entries, unpacked once on open so find() never writes and can be used from any thread
+	std::vector<std::vector<uint8_t>> unpacked;
+
+	bool validate();
+};
@@ -0,0 +1,228 @@
+#include "board.h"
+
+const uint8_t Board::WALL;
+const uint8_t Board::GARBAGE;
+const int Board::hiddenRows;
+
+Board::Board(int width, int height, gridShape shape, int spawnWidth) : width(width), height(height), cells(width * height, 0), maskWords((width + 63) / 64), rectangular(true) {
+	mask.assign(height * maskWords, 0);
+
+	int visible = std::max(1, height - hiddenRows);
+
+	bool channelReached = false;
+
+	for (int y = 0; y < height; y++) {
+		bool channelOpen = true;
+
+		for (int x = 0; x < width; x++) {
+			/// u and v are the center of the cell, from -1 to 1 across the visible area
+			float u = 2.0F * (x + 0.5F) / width - 1.0F;
+			float v = 2.0F * (y - hiddenRows + 0.5F) / visible - 1.0F;
+			bool inside = true;
+
+			if (y >= hiddenRows) {
+				switch (shape) {
+				case CIRCLE:
+					inside = u * u + v * v <= 1.0F;
+					break;
+				case TRIANGLE:
+					inside = fabs(u) <= (v + 1.0F) / 2.0F;
+					break;
+				case HEXAGON:
+					inside = fabs(v) <= 1.0F - fabs(u) / 2.0F;
+					break;
+				case ARROW:
+					inside = v < -0.2F ? fabs(u) <= (v + 1.0F) * 1.25F : fabs(u) <= 0.5F;
+					break;
+				default:
+					break;
+				}
+			}
+
+			/// Keep a channel open down the middle until the grid shape is wide enough for shapes to fall into it
+			if (!inside && abs(2 * x + 1 - width) < spawnWidth) {
+				channelOpen = false;
+				inside = !channelReached;
+			}
+
+			if (inside) {
+				mask[y * maskWords + x / 64] |= (uint64_t) 1 << (x % 64);
+			} else {
+				cells[y * width + x] = WALL;
+				rectangular = false;
+			}
+		}
+
+		if (y >= hiddenRows && channelOpen) channelReached = true;
+	}
+
+	standard = rectangular && width == 10 && height == 22;
+}
+
+bool Board::rowFull(int y) const {
+	const uint8_t *row = (*this)[y];
+	if (std::find(row, row + width, 0) != row + width) return false;
+
+	for (int w = 0; w < maskWords; w++) {
+		if (mask[y * maskWords + w]) return true;
+	}
+	return false; // Rows entirely outside the grid shape are never cleared
+}
+
+/// Removes every full row, shifting the rows above down. Returns the number of rows removed
+int Board::clearLines() {
+	if (standard) return clearFullRows<10, 22>(cells.data(), 10, 22);
+	if (rectangular) return clearFullRows(cells.data(), width, height);
+
+	int cleared = 0;
+
+	std::vector<bool> full(height);
+	for (int y = 0; y < height; y++) {
+		full[y] = rowFull(y);
+		if (full[y]) cleared++;
+	}
+
+	if (cleared == 0) return 0;
+
+	/// Walls stay where they are, so each run of cells between walls in a column is compacted on its own
+	for (int x = 0; x < width; x++) {
+		int write = height - 1;
+
+		for (int read = height - 1; read >= -1; read--) {
+			if (read < 0 || cells[read * width + x] == WALL) {
+				for (; write > read; write--) cells[write * width + x] = 0;
+				write = read - 1;
+			} else if (!full[read]) {
+				cells[write * width + x] = cells[read * width + x];
+				write--;
+			}
+		}
+	}
+
+	return cleared;
+}
+
+/// Flood fill gravity: every group of connected cells falls on its own until nothing can move. Returns the number of times a group moved
+int Board::settle() {
+	std::vector<int> &parent = scratch.parent, &group = scratch.group, &groupStart = scratch.groupStart, &groupCells = scratch.groupCells;
+	std::vector<uint8_t> &lifted = scratch.lifted;
+
+	int count = width * height;
+	parent.resize(count);
+	group.assign(count, -1);
+
+	for (int i = 0; i < count; i++) parent[i] = i;
+
+	auto find = [&parent](int i) {
+		while (parent[i] != i) i = parent[i] = parent[parent[i]];
+		return i;
+	};
+
+	for (int i = 0; i < count; i++) {
+		if (cells[i] == 0 || cells[i] == WALL) continue;
+
+		if (i % width + 1 < width && cells[i + 1] != 0 && cells[i + 1] != WALL) parent[find(i + 1)] = find(i);
+		if (i + width < count && cells[i + width] != 0 && cells[i + width] != WALL) parent[find(i + width)] = find(i);
+	}
+
+	/// Number the groups from the bottom up so lower groups settle first, then list each group's cells together
+	int groups = 0;
+	groupStart.assign(1, 0);
+
+	for (int i = count - 1; i >= 0; i--) {
+		if (cells[i] == 0 || cells[i] == WALL) continue;
+
+		int root = find(i);
+		if (group[root] < 0) {
+			group[root] = groups++;
+			groupStart.push_back(0);
+		}
+		group[i] = group[root];
+		groupStart[group[i] + 1]++;
+	}
+
+	for (int g = 0; g < groups; g++) groupStart[g + 1] += groupStart[g];
+
+	groupCells.resize(groupStart[groups]);
+	std::vector<int> &next = parent; // No longer needed for finding roots
+	std::copy(groupStart.begin(), groupStart.end() - 1, next.begin());
+
+	for (int i = 0; i < count; i++) {
+		if (group[i] >= 0) groupCells[next[group[i]]++] = i;
+	}
+
+	int moves = 0;
+	bool moved = true;
+
+	while (moved) {
+		moved = false;
+
+		for (int g = 0; g < groups; g++) {
+			int distance = height;
+
+			for (int c = groupStart[g]; c < groupStart[g + 1] && distance > 0; c++) {
+				int d = 0;
+				bool own = false;
+
+				for (int below = groupCells[c] + width; d < distance && below < count; below += width) {
+					if (cells[below] != 0) {
+						own = group[below] == g; // The lower cell of the group decides the distance instead
+						break;
+					}
+					d++;
+				}
+
+				if (!own) distance = d;
+			}
+
+			if (distance == 0) continue;
+
+			/// Lift the whole group before putting it back down, since it may overlap its own old cells
+			lifted.clear();
+			for (int c = groupStart[g]; c < groupStart[g + 1]; c++) {
+				lifted.push_back(cells[groupCells[c]]);
+				cells[groupCells[c]] = 0;
+				group[groupCells[c]] = -1;
+			}
+
+			for (int c = groupStart[g]; c < groupStart[g + 1]; c++) {
+				groupCells[c] += distance * width;
+				cells[groupCells[c]] = lifted[c - groupStart[g]];
+				group[groupCells[c]] = g;
+			}
+
+			moves++;
+			moved = true;
+		}
+	}
+
+	return moves;
+}
+
+/// Pushes everything inside the grid shape up by rows and fills the bottom rows with garbage. Each row's hole is its hole % n-th cell inside the grid shape,
+/// so narrow rows of a masked grid still get one. Cells pushed past the top are lost
+void Board::addGarbage(int rows, uint64_t hole) {
+	rows = std::min(rows, height);
+
+	if (rectangular) {
+		memmove(cells.data(), cells.data() + rows * width, (height - rows) * width);
+	} else {
+		for (int y = 0; y < height - rows; y++) {
+			for (int x = 0; x < width; x++) {
+				if (inMask(x, y)) cells[y * width + x] = inMask(x, y + rows) ? cells[(y + rows) * width + x] : 0;
+			}
+		}
+	}
+
+	for (int y = height - rows; y < height; y++) {
+		int inside = 0;
+		for (int x = 0; x < width; x++) inside += inMask(x, y);
+		if (inside == 0) continue;
+
+		int skip = (int) (hole % inside);
+		for (int x = 0; x < width; x++) {
+			if (!inMask(x, y)) continue;
+			cells[y * width + x] = skip-- == 0 ? 0 : GARBAGE;
+		}
+	}
+}
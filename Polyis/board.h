@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "kernels.h"
+
+/// Same order as the "Grid Shape" custom option
+enum gridShape {
+	RECTANGLE,
+	CIRCLE,
+	TRIANGLE,
+	HEXAGON,
+	ARROW
+};
+
+/// Playfield stored as one byte per cell, row-major. 0 is an empty cell, anything else is an index into Shape::palette
+class Board {
+public:
+	/// Cell value for positions outside the grid shape. Collision only checks for non-zero cells, so walls cost nothing extra
+	static const uint8_t WALL = 0xFF;
+	/// Cell value for garbage rows sent by opponents, the last palette color
+	static const uint8_t GARBAGE = 8;
+	/// Rows above the visible area that shapes spawn in. The grid shape is only applied below them
+	static const int hiddenRows = 2;
+
+	Board(int width = 10, int height = 22, gridShape shape = RECTANGLE, int spawnWidth = 4);
+
+	int width, height;
+	std::vector<uint8_t> cells;
+
+	/// One bit per cell, set if the cell is inside the grid shape. Each row is maskWords words long
+	std::vector<uint64_t> mask;
+	int maskWords;
+	bool rectangular;
+	/// Rectangular 10x22, the standard playfield that gets the compile time kernels
+	bool standard;
+
+	uint8_t *operator[](int y) { return &cells[y * width]; }
+	const uint8_t *operator[](int y) const { return &cells[y * width]; }
+
+	bool inMask(int x, int y) const { return (mask[y * maskWords + x / 64] >> (x % 64)) & 1; }
+
+	int clearLines();
+	int settle();
+	void addGarbage(int rows, uint64_t hole);
+
+private:
+	/// Buffers settle() reuses between calls. Copies of a board start with their own empty ones instead of copying these, so boards on different threads never share them
+	struct settleScratch {
+		std::vector<int> parent, group, groupStart, groupCells;
+		std::vector<uint8_t> lifted;
+
+		settleScratch() {}
+		settleScratch(const settleScratch &) {}
+		settleScratch &operator=(const settleScratch &) { return *this; }
+	} scratch;
+
+	bool rowFull(int y) const;
+};
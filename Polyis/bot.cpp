@@ -0,0 +1,109 @@
+#include "bot.h"
+
+#include <cstdlib>
+
+int Bot::next(const Game &game) {
+	if (game.ended) return -1;
+
+	if (game.shapeCount != plannedShape) {
+		makePlan(game);
+		plannedShape = game.shapeCount;
+	}
+
+	if (planStep >= plan.size()) return -1;
+	if (planStep == waitStep && game.currentShape.y < waitY) return -1;
+	return plan[planStep++];
+}
+
+void Bot::makePlan(const Game &game) {
+	float bestScore = -1e30F;
+	int bestRotations = 0, bestMoves = 0, bestY = game.currentShape.y;
+
+	// Outside a rectangle shapes spawn in a channel above the grid shape, where moving sideways only drops them on the walls.
+	// So every row the shape can fall to is tried as the one to turn and move on
+	Shape start = game.currentShape;
+
+	while (true) {
+		Shape rotated = start;
+
+		for (int r = 0; r < 4; r++) {
+			if (r > 0 && !rotated.rotate(game.grid, true)) break;
+
+			for (int direction = -1; direction <= 1; direction += 2) {
+				Shape moved = rotated;
+
+				for (int moves = 0; ; moves++) {
+					if (moves > 0 && !moved.move(game.grid, direction > 0)) break;
+					if (moves == 0 && direction > 0) continue; // Not moving at all was already tried going left
+
+					float score = evaluate(game, moved);
+					if (score > bestScore) {
+						bestScore = score;
+						bestRotations = r;
+						bestMoves = moves * direction;
+						bestY = start.y;
+					}
+				}
+			}
+		}
+
+		if (game.grid.rectangular || !start.fall(game.grid, true)) break;
+	}
+
+	plan.clear();
+	planStep = 0;
+	waitStep = -1;
+
+	if (bestY > game.currentShape.y) {
+		plan.push_back(SOFT_DROP);
+		waitStep = (int) plan.size();
+		waitY = bestY;
+		plan.push_back(SOFT_DROP_RELEASE);
+	}
+
+	for (int r = 0; r < bestRotations; r++) plan.push_back(ROTATE_CLOCKWISE);
+	for (int m = 0; m < abs(bestMoves); m++) plan.push_back(bestMoves > 0 ? MOVE_RIGHT : MOVE_LEFT);
+	plan.push_back(HARD_DROP);
+}
+
+/// Weights from the usual four feature Tetris heuristic
+float Bot::evaluate(const Game &game, const Shape &shape) {
+	scratch = game.grid;
+
+	Shape dropped = shape;
+	dropped.y = shape.landingY(scratch);
+
+	const gridArray &data = dropped.data();
+	for (int y = 0; y < data.size(); y++) {
+		for (int x = 0; x < data.size(); x++) {
+			if (data[y][x]) scratch[dropped.y + y][dropped.x + x] = data[y][x];
+		}
+	}
+
+	int lines = scratch.clearLines();
+	int totalHeight = 0, holes = 0, bumpiness = 0, lastHeight = -1;
+
+	for (int x = 0; x < scratch.width; x++) {
+		// Heights count from the bottom of the column inside the grid shape, so columns at the edge of a circle don't look stacked already
+		int floor = scratch.height;
+		while (floor > 0 && scratch[floor - 1][x] == Board::WALL) floor--;
+
+		int height = 0;
+		for (int y = 0; y < floor; y++) {
+			uint8_t cell = scratch[y][x];
+			if (cell == Board::WALL) continue;
+
+			if (cell) {
+				if (height == 0) height = floor - y;
+			} else if (height > 0) {
+				holes++;
+			}
+		}
+
+		totalHeight += height;
+		if (lastHeight >= 0) bumpiness += abs(height - lastHeight);
+		lastHeight = height;
+	}
+
+	return -0.51F * totalHeight + 0.76F * lines - 0.36F * holes - 0.18F * bumpiness;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+
+#include "game.h"
+
+/// Plays by trying every rotation and column for the current shape and scoring the board it leaves (height, holes, bumpiness, lines).
+/// It presses one key per tick like a player would, which makes its games useful as replays for profiling
+class Bot {
+public:
+	/// Input to give the game this tick, or -1 to wait
+	int next(const Game &game);
+
+private:
+	std::vector<gameInput> plan;
+	int planStep = 0;
+	/// Plan step that waits until the shape has fallen to waitY, for shapes that spawn in the channel above a grid shape
+	int waitStep = -1, waitY = 0;
+	unsigned int plannedShape = 0;
+	Board scratch;
+
+	void makePlan(const Game &game);
+	float evaluate(const Game &game, const Shape &shape);
+};
@@ -0,0 +1,294 @@
+#include "game.h"
+#include "replay.h"
+
+const float Game::lineClearPoints[6] = {100, 300, 500, 800, 1.5, 50};
+const float Game::tickLength = 1.0F / 120.0F;
+const unsigned int Game::garbageRows[4] = {0, 1, 2, 4};
+
+void Game::begin(const gameSettings &newSettings, uint64_t seed) {
+	settings = newSettings;
+
+	grid = Board(settings.width, settings.height, settings.shape, Shape::tiles);
+	currentShape = Shape();
+	int shapeCount = (int) Shape::shapes.size();
+	queue.reset(shapeCount, seed, shapeCount > Randomizer::largeSetBag ? Randomizer::largeSetBag : 0);
+	heldIndex = -1;
+
+	score = lines = lineClearCombos = 0;
+	lastClearDifficult = false;
+
+	fastFallTime = normalFallTime = lockTime = 0.0F;
+	isFast = isLocking = ended = false;
+	canHold = true;
+
+	level = settings.startingLevel;
+	normalSpeed = (0.3F * (float) pow(level, 1.5F) + 0.7F) * (float) pow(2, settings.gravityMultiplier);
+	lockDelay = ((float) (sqrt(level) + 2) / 6) * (float) pow(2, settings.lockDelayMultiplier);
+	fastSpeed = std::max(30.0F, normalSpeed);
+
+	lives = settings.lives;
+	ticks = shapeCount = 0;
+	incomingGarbage = outgoingGarbage = 0;
+	garbageState = seed ^ 0x9E3779B97F4A7C15ULL;
+	if (garbageState == 0) garbageState = 1;
+
+	events = STATS_CHANGED;
+
+	newShape();
+}
+
+void Game::update() {
+	if (ended) return;
+
+	ticks++;
+
+	if (isLocking) {
+		lockTime += tickLength;
+		if (lockTime >= lockDelay) {
+			addShape();
+			isLocking = false;
+			lockTime = 0;
+		} else if (currentShape.fall(grid, false)) {
+			isLocking = false;
+			lockTime = 0;
+		}
+	} else {
+		(isFast ? fastFallTime : normalFallTime) += tickLength;
+
+		if ((isFast ? fastFallTime : normalFallTime) >= 1 / (isFast ? fastSpeed : normalSpeed)) {
+			(isFast ? fastFallTime : normalFallTime) -= 1 / (isFast ? fastSpeed : normalSpeed);
+			if (isFast) {
+				score++;
+				events |= STATS_CHANGED;
+			}
+
+			fall();
+		}
+	}
+}
+
+void Game::input(gameInput input) {
+	if (recording != NULL) recording->inputs.push_back({ticks, (uint8_t) input});
+
+	switch (input) {
+	case MOVE_LEFT:
+	case MOVE_RIGHT:
+		move(input == MOVE_RIGHT);
+		break;
+	case ROTATE_CLOCKWISE:
+	case ROTATE_COUNTERCLOCKWISE:
+		rotate(input == ROTATE_CLOCKWISE);
+		break;
+	case SOFT_DROP:
+		isFast = true;
+		break;
+	case SOFT_DROP_RELEASE:
+		isFast = false;
+		break;
+	case HARD_DROP:
+		hardDrop();
+		break;
+	case HOLD:
+		hold();
+		break;
+	}
+}
+
+bool Game::move(bool right) {
+	if (ended || !currentShape.move(grid, right)) return false;
+
+	lockTime = 0;
+	events |= SHAPE_MOVED;
+	return true;
+}
+
+bool Game::rotate(bool clockwise) {
+	if (ended || !currentShape.rotate(grid, clockwise)) return false;
+
+	lockTime = 0;
+	events |= SHAPE_ROTATED;
+	return true;
+}
+
+void Game::hardDrop() {
+	if (ended) return;
+
+	int landingY = currentShape.landingY(grid);
+	if (landingY > currentShape.y) {
+		score += 2 * (landingY - currentShape.y);
+		events |= STATS_CHANGED;
+		currentShape.y = landingY;
+	}
+	isLocking = true;
+	lockTime = lockDelay;
+}
+
+void Game::hold() {
+	if (ended || !canHold) return;
+
+	// The held shape is set before spawning so the checkpoint saved with the new shape keeps it
+	int p = currentShape.index, swapped = heldIndex;
+	heldIndex = p;
+	if (swapped == -1) {
+		newShape(false);
+		return;
+	}
+
+	currentShape = Shape(swapped);
+	currentShape.x = (grid.width - currentShape.data().size()) / 2;
+	if (checkGameOver()) return;
+
+	isFast = false;
+	canHold = false;
+}
+
+unsigned int Game::takeEvents() {
+	unsigned int taken = events;
+	events = 0;
+	return taken;
+}
+
+void Game::addGarbage(unsigned int rows) {
+	if (!ended) incomingGarbage += rows;
+}
+
+unsigned int Game::takeGarbage() {
+	unsigned int taken = outgoingGarbage;
+	outgoingGarbage = 0;
+	return taken;
+}
+
+fallState Game::fall() {
+	if (!currentShape.fall(grid, true)) {
+		isLocking = true;
+		return PLACED;
+	}
+	return FELL;
+}
+
+void Game::addShape() {
+	for (int x = 0; x < currentShape.data().size(); x++) {
+		for (int y = 0; y < currentShape.data().size(); y++) {
+			if (currentShape.data()[y][x]) {
+				grid[currentShape.y + y][currentShape.x + x] = currentShape.data()[y][x];
+			}
+		}
+	}
+
+	int linesCleared = grid.clearLines();
+
+	if (settings.floodFill) { // Keep clearing as long as the falling groups complete more lines
+		for (int chained = linesCleared; chained > 0 && grid.settle() > 0;) {
+			chained = grid.clearLines();
+			linesCleared += chained;
+		}
+	}
+
+	if (linesCleared > 0) {
+		lines += linesCleared;
+
+		int points = std::min(linesCleared, 4);
+		score += (int) (lineClearPoints[points - 1] * level * ((points == 4 && lastClearDifficult) ? lineClearPoints[4] : 1) + lineClearPoints[5] * lineClearCombos * level);
+
+		// Clears cancel garbage on its way in before any is sent out
+		unsigned int attack = garbageRows[points - 1] + ((points == 4 && lastClearDifficult) ? 1 : 0);
+		unsigned int cancelled = std::min(attack, incomingGarbage);
+		incomingGarbage -= cancelled;
+		outgoingGarbage += attack - cancelled;
+
+		lastClearDifficult = points == 4;
+		lineClearCombos++;
+		level = settings.startingLevel + lines / settings.linesPerLevel;
+		normalSpeed = (0.3F * (float) pow(level, 1.5F) + 0.7F) * (float) pow(2, settings.gravityMultiplier);
+		lockDelay = (float) (sqrt(level) + 2.0F) / 6.0F;
+		fastSpeed = std::max(fastSpeed, normalSpeed);
+
+		events |= STATS_CHANGED | (lastClearDifficult ? DIFFICULT_CLEAR : LINES_CLEARED);
+	} else {
+		lineClearCombos = 0;
+		events |= SHAPE_PLACED;
+
+		if (incomingGarbage > 0) {
+			// xorshift64, the same steps for every board seeded alike
+			garbageState ^= garbageState << 13;
+			garbageState ^= garbageState >> 7;
+			garbageState ^= garbageState << 17;
+
+			grid.addGarbage(incomingGarbage, garbageState);
+			incomingGarbage = 0;
+			events |= GARBAGE_ADDED;
+		}
+	}
+
+	newShape();
+}
+
+void Game::newShape(bool holdAllowed) {
+	currentShape = Shape(queue.pop());
+	currentShape.x = (grid.width - currentShape.data().size()) / 2;
+	shapeCount++;
+
+	if (checkGameOver()) return;
+
+	isFast = false;
+	canHold = holdAllowed;
+
+	saveCheckpoint();
+}
+
+/// Ends the game if the current shape overlaps the board, or goes back to the last checkpoint when there are lives left
+bool Game::checkGameOver() {
+	for (int x = 0; x < currentShape.data().size(); x++) {
+		for (int y = 0; y < currentShape.data().size(); y++) {
+			if (currentShape.data()[y][x] && grid[currentShape.y + y][currentShape.x + x]) {
+				if (lives > 0) {
+					lives--;
+					loadCheckpoint();
+					events |= LIFE_LOST | STATS_CHANGED;
+					return true;
+				}
+
+				ended = true;
+				events |= GAME_OVER;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+void Game::saveCheckpoint() {
+	checkpoint.grid = grid;
+	checkpoint.currentShape = currentShape;
+	checkpoint.queue = queue;
+	checkpoint.heldIndex = heldIndex;
+	checkpoint.score = score;
+	checkpoint.lines = lines;
+	checkpoint.level = level;
+	checkpoint.lineClearCombos = lineClearCombos;
+	checkpoint.lastClearDifficult = lastClearDifficult;
+	checkpoint.canHold = canHold;
+	checkpoint.fastSpeed = fastSpeed;
+	checkpoint.normalSpeed = normalSpeed;
+	checkpoint.lockDelay = lockDelay;
+}
+
+void Game::loadCheckpoint() {
+	grid = checkpoint.grid;
+	currentShape = checkpoint.currentShape;
+	queue = checkpoint.queue;
+	heldIndex = checkpoint.heldIndex;
+	score = checkpoint.score;
+	lines = checkpoint.lines;
+	level = checkpoint.level;
+	lineClearCombos = checkpoint.lineClearCombos;
+	lastClearDifficult = checkpoint.lastClearDifficult;
+	canHold = checkpoint.canHold;
+	fastSpeed = checkpoint.fastSpeed;
+	normalSpeed = checkpoint.normalSpeed;
+	lockDelay = checkpoint.lockDelay;
+
+	fastFallTime = normalFallTime = lockTime = 0.0F;
+	isFast = isLocking = false;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "board.h"
+#include "shape.h"
+#include "shapeQueue.h"
+
+enum fallState {
+	FELL,
+	PLACED,
+};
+
+/// Same order as the "Gravity Direction" custom option. The board is always stored with gravity pointing down, only painting and controls are turned
+enum gravityDirection {
+	FALL_DOWN,
+	FALL_UP,
+	FALL_LEFT,
+	FALL_RIGHT
+};
+
+/// Everything a player can do. Games only change through these and update, so a list of them with the tick they happened on replays a game exactly
+enum gameInput {
+	MOVE_LEFT,
+	MOVE_RIGHT,
+	ROTATE_CLOCKWISE,
+	ROTATE_COUNTERCLOCKWISE,
+	SOFT_DROP,
+	SOFT_DROP_RELEASE,
+	HARD_DROP,
+	HOLD
+};
+
+/// Things the frontend reacts to (sounds, text), collected as flags while the game runs and taken once per frame
+enum gameEvent {
+	SHAPE_MOVED = 1,
+	SHAPE_ROTATED = 2,
+	LINES_CLEARED = 4,
+	DIFFICULT_CLEAR = 8,
+	SHAPE_PLACED = 16,
+	LIFE_LOST = 32,
+	GAME_OVER = 64,
+	STATS_CHANGED = 128,
+	GARBAGE_ADDED = 256
+};
+
+/// Everything a game is started with. The defaults are a standard game
+struct gameSettings {
+	int width = 10, height = 22;
+	gridShape shape = RECTANGLE;
+	gravityDirection gravity = FALL_DOWN;
+	/// Powers of two, same as the "Gravity Multiplier" and "Lock Delay Time" custom options
+	int gravityMultiplier = 0, lockDelayMultiplier = 0;
+	bool floodFill = false;
+	int lives = 0;
+	int linesPerLevel = 10;
+	int startingLevel = 1;
+};
+
+class Replay;
+
+/// The rules of one game, without anything to do with SDL, so it can run headless
+class Game {
+public:
+	static const float lineClearPoints[6];
+	/// Garbage rows sent for clearing 1 to 4 lines at once, plus one for back to back difficult clears
+	static const unsigned int garbageRows[4];
+	/// Length of one update in seconds. Fixed so the same inputs always give the same game
+	static const float tickLength;
+
+	gameSettings settings;
+
+	Board grid;
+	Shape currentShape;
+	ShapeQueue queue;
+	int heldIndex = -1;
+
+	unsigned int score = 0, lines = 0, level = 1, lineClearCombos = 0;
+	bool lastClearDifficult = false;
+
+	float fastSpeed = 30.0F, normalSpeed = 1.0F, fastFallTime = 0.0F, normalFallTime = 0.0F, lockTime = 0.0F, lockDelay = .25F;
+	bool isFast = false, canHold = true, isLocking = false, ended = false;
+
+	int lives = 0;
+
+	/// Updates since the game began and shapes spawned since then
+	unsigned int ticks = 0, shapeCount = 0;
+
+	/// Garbage rows waiting to be pushed in when the next shape locks without clearing, and rows this game has cleared for its opponents
+	unsigned int incomingGarbage = 0, outgoingGarbage = 0;
+	/// Picks the hole column of each garbage batch, seeded with the game so every board gets the same holes
+	uint64_t garbageState = 1;
+
+	/// Inputs are added to this replay when it is set
+	Replay *recording = NULL;
+
+	void begin(const gameSettings &newSettings, uint64_t seed);
+	/// Advances the game by one tick
+	void update();
+	void input(gameInput input);
+
+	bool move(bool right);
+	bool rotate(bool clockwise);
+	void hardDrop();
+	void hold();
+
+	/// Events since the last call
+	unsigned int takeEvents();
+
+	void addGarbage(unsigned int rows);
+	/// Garbage rows cleared for opponents since the last call
+	unsigned int takeGarbage();
+
+private:
+	/// Game as it was when the current shape spawned, put back when a life is lost. Copying into the same vectors every time reuses their memory, so saving one per shape is just a few memcpys
+	struct checkpointState {
+		Board grid;
+		Shape currentShape;
+		ShapeQueue queue;
+		int heldIndex;
+		unsigned int score, lines, level, lineClearCombos;
+		bool lastClearDifficult, canHold;
+		float fastSpeed, normalSpeed, lockDelay;
+	} checkpoint;
+
+	unsigned int events = 0;
+
+	fallState fall();
+	void addShape();
+	void newShape(bool holdAllowed = true);
+	bool checkGameOver();
+
+	void saveCheckpoint();
+	void loadCheckpoint();
+};
@@ -0,0 +1,339 @@
+#include "highScores.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <io.h>
+#define fsync _commit
+#define fileno _fileno
+#else
+#include <unistd.h>
+#endif
+
+const int HighScores::topCount;
+const uint32_t HighScores::magic;
+const uint32_t HighScores::statsMagic;
+const uint32_t HighScores::version;
+const int HighScores::headerSize;
+
+static const uint64_t customBit = 1ull << 63;
+
+uint64_t HighScores::standardMode(int level) {
+	return (uint64_t) level;
+}
+
+/// FNV-1a over the settings that change how a game plays
+uint64_t HighScores::customMode(const gameSettings &settings) {
+	int32_t fields[] = {settings.width, settings.height, settings.shape, settings.gravity, settings.gravityMultiplier, settings.lockDelayMultiplier, settings.floodFill, settings.lives, settings.linesPerLevel, settings.startingLevel};
+
+	uint64_t hash = 14695981039346656037ull;
+	const uint8_t *bytes = (const uint8_t*) fields;
+	for (int i = 0; i < sizeof(fields); i++) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+
+	return hash | customBit;
+}
+
+bool HighScores::isCustomMode(uint64_t mode) {
+	return (mode & customBit) != 0;
+}
+
+HighScores::~HighScores() {
+	close();
+}
+
+bool HighScores::load(const char *logPath, const char *statsPath, const char *legacyPath) {
+	close();
+	path = logPath;
+	this->statsPath = statsPath == NULL ? "" : statsPath;
+	tops.clear();
+	logged = 0;
+
+	recoverStats();
+
+	FILE *file = fopen(logPath, "rb");
+
+	if (file == NULL) {
+		if (legacyPath == NULL || (file = fopen(legacyPath, "r")) == NULL) return false;
+
+		int score;
+		char name[64];
+		while (fscanf(file, "%d %63[^\n]", &score, name) == 2) {
+			scoreRecord record = {standardMode(1), (uint32_t) std::max(0, score), 0, 1};
+			strncpy(record.name, name, sizeof(record.name) - 1);
+			insert(record);
+		}
+		fclose(file);
+
+		compact();
+		return true;
+	}
+
+	std::vector<uint8_t> contents;
+	if (fseek(file, 0, SEEK_END) == 0) {
+		long size = ftell(file);
+		if (size > 0) {
+			contents.resize(size);
+			rewind(file);
+			contents.resize(fread(contents.data(), 1, size, file));
+		}
+	}
+	fclose(file);
+
+	// The header is written together with the first records, so a shorter file is a log whose first write never finished
+	if (contents.size() < headerSize) {
+		if (!contents.empty()) printf("Scores: dropping the unfinished header of \"%s\"\n", logPath);
+		std::error_code error;
+		std::filesystem::resize_file(logPath, 0, error);
+		if (error) printf("Error: Failed to truncate \"%s\"\n", logPath);
+		return true;
+	}
+
+	uint32_t header[2];
+	memcpy(header, contents.data(), headerSize);
+
+	if (header[0] != magic || header[1] != version) {
+		printf("Error: \"%s\" is not a score log\n", logPath);
+		path.clear(); // Leave it alone rather than appending to something else
+		return false;
+	}
+
+	// Everything up to the first record that is cut short or fails its checksum is kept, the rest is a write that never finished
+	size_t offset = headerSize;
+	for (; offset + sizeof(scoreRecord) <= contents.size(); offset += sizeof(scoreRecord)) {
+		scoreRecord record;
+		memcpy(&record, contents.data() + offset, sizeof(record));
+		if (record.checksum != checksum(record)) break;
+
+		record.name[sizeof(record.name) - 1] = 0;
+		insert(record);
+		logged++;
+	}
+
+	if (offset < contents.size()) {
+		printf("Scores: dropping %zu bytes of damaged or unfinished records from the end of \"%s\"\n", contents.size() - offset, logPath);
+		std::error_code error;
+		std::filesystem::resize_file(logPath, offset, error);
+		if (error) printf("Error: Failed to truncate \"%s\"\n", logPath);
+	}
+
+	if (logged > kept() * 2 + 64) compact();
+	return true;
+}
+
+void HighScores::add(uint64_t mode, const std::string &name, const Game &game) {
+	scoreRecord record = {mode, game.score, game.lines, (uint32_t) game.level, game.ticks, game.shapeCount, (uint32_t) time(0)};
+	strncpy(record.name, name.c_str(), sizeof(record.name) - 1);
+	record.checksum = checksum(record);
+	insert(record);
+
+	if (path.empty()) return;
+
+	logged++;
+	queue({false, {record}});
+	if (logged > kept() * 2 + 64) compact();
+}
+
+void HighScores::close() {
+	if (!writer.joinable()) return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	writer.join();
+	stopping = false;
+}
+
+const std::vector<scoreRecord> &HighScores::top(uint64_t mode) const {
+	static const std::vector<scoreRecord> empty;
+	auto found = tops.find(mode);
+	return found == tops.end() ? empty : found->second;
+}
+
+std::vector<uint64_t> HighScores::modes() const {
+	std::vector<uint64_t> result;
+	for (auto &entry : tops) result.push_back(entry.first);
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+/// The stats log is only ever appended to, so a crash can only have damaged its last records. They are checked from the end back until one is whole
+void HighScores::recoverStats() {
+	if (statsPath.empty()) return;
+
+	FILE *file = fopen(statsPath.c_str(), "rb");
+	if (file == NULL) return;
+
+	long size = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+	uint32_t header[2] = {};
+	bool whole = size >= headerSize && fseek(file, 0, SEEK_SET) == 0 && fread(header, sizeof(header), 1, file) == 1;
+
+	if (whole && (header[0] != statsMagic || header[1] != version)) {
+		fclose(file);
+		printf("Error: \"%s\" is not a stats log\n", statsPath.c_str());
+		statsPath.clear();
+		return;
+	}
+
+	long end = whole ? headerSize + (size - headerSize) / (long) sizeof(scoreRecord) * (long) sizeof(scoreRecord) : 0;
+	for (; end > headerSize; end -= sizeof(scoreRecord)) {
+		scoreRecord record;
+		if (fseek(file, end - (long) sizeof(scoreRecord), SEEK_SET) == 0 && fread(&record, sizeof(record), 1, file) == 1 && record.checksum == checksum(record)) break;
+	}
+	fclose(file);
+
+	if (end < size) {
+		printf("Scores: dropping %ld bytes of damaged or unfinished records from the end of \"%s\"\n", size - end, statsPath.c_str());
+		std::error_code error;
+		std::filesystem::resize_file(statsPath, end, error);
+		if (error) printf("Error: Failed to truncate \"%s\"\n", statsPath.c_str());
+	}
+}
+
+void HighScores::compact() {
+	if (path.empty()) return;
+
+	// Best first keeps tied scores in the order they were set when the log is read again
+	writeJob job = {true, {}};
+	for (uint64_t mode : modes()) {
+		const std::vector<scoreRecord> &records = tops[mode];
+		job.records.insert(job.records.end(), records.begin(), records.end());
+	}
+
+	for (int n = 0; n < job.records.size(); n++) job.records[n].checksum = checksum(job.records[n]); // Imported scores don't have one yet
+
+	logged = kept();
+	queue(job);
+}
+
+/// Keeps the list sorted best first and at most topCount long. Ties go after the scores already there
+void HighScores::insert(const scoreRecord &record) {
+	std::vector<scoreRecord> &records = tops[record.mode];
+	if (records.size() >= topCount && record.score <= records.back().score) return;
+
+	auto position = std::upper_bound(records.begin(), records.end(), record, [](const scoreRecord &a, const scoreRecord &b) { return a.score > b.score; });
+	records.insert(position, record);
+	if (records.size() > topCount) records.pop_back();
+}
+
+size_t HighScores::kept() const {
+	size_t count = 0;
+	for (auto &entry : tops) count += entry.second.size();
+	return count;
+}
+
+void HighScores::queue(writeJob job) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(job);
+	}
+
+	if (!writer.joinable()) writer = std::thread(&HighScores::writeLoop, this);
+	wake.notify_one();
+}
+
+/// Takes every job queued so far at once, so scores that finish close together share one fsync
+void HighScores::writeLoop() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (true) {
+		wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+		if (jobs.empty()) break;
+
+		std::deque<writeJob> batch;
+		batch.swap(jobs);
+		lock.unlock();
+
+		std::vector<scoreRecord> appended, stats;
+		for (int n = 0; n < batch.size(); n++) {
+			if (batch[n].compact) {
+				append(log, path, magic, appended);
+				appended.clear();
+				rewrite(batch[n].records);
+			} else {
+				appended.insert(appended.end(), batch[n].records.begin(), batch[n].records.end());
+				stats.insert(stats.end(), batch[n].records.begin(), batch[n].records.end());
+			}
+		}
+		append(log, path, magic, appended);
+		if (!statsPath.empty()) append(statsLog, statsPath, statsMagic, stats);
+
+		lock.lock();
+	}
+
+	if (log != NULL) fclose(log);
+	if (statsLog != NULL) fclose(statsLog);
+	log = statsLog = NULL;
+}
+
+bool HighScores::append(FILE *&file, const std::string &filePath, uint32_t fileMagic, const std::vector<scoreRecord> &records) {
+	if (records.empty()) return true;
+
+	if (file == NULL) {
+		file = fopen(filePath.c_str(), "ab");
+		if (file == NULL) {
+			printf("Error: Failed to write scores \"%s\"\n", filePath.c_str());
+			return false;
+		}
+
+		fseek(file, 0, SEEK_END);
+		if (ftell(file) == 0) {
+			uint32_t header[2] = {fileMagic, version};
+			fwrite(header, sizeof(header), 1, file);
+		}
+	}
+
+	bool written = fwrite(records.data(), sizeof(scoreRecord), records.size(), file) == records.size();
+	written = fflush(file) == 0 && fsync(fileno(file)) == 0 && written;
+	if (!written) printf("Error: Failed to write scores \"%s\"\n", filePath.c_str());
+	return written;
+}
+
+/// Replaces the log through a temporary file, so a crash leaves either the old log or the new one
+bool HighScores::rewrite(const std::vector<scoreRecord> &records) {
+	if (log != NULL) fclose(log);
+	log = NULL;
+
+	std::string temporary = path + ".tmp";
+	FILE *file = fopen(temporary.c_str(), "wb");
+	if (file == NULL) {
+		printf("Error: Failed to write scores \"%s\"\n", temporary.c_str());
+		return false;
+	}
+
+	uint32_t header[2] = {magic, version};
+	bool written = fwrite(header, sizeof(header), 1, file) == 1;
+	written = fwrite(records.data(), sizeof(scoreRecord), records.size(), file) == records.size() && written;
+	written = fflush(file) == 0 && fsync(fileno(file)) == 0 && written;
+	written = fclose(file) == 0 && written;
+
+	std::error_code error;
+	if (written) std::filesystem::rename(temporary, path, error);
+	if (!written || error) {
+		printf("Error: Failed to replace scores \"%s\"\n", path.c_str());
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+
+	return true;
+}
+
+/// CRC-32 (the zlib one) of the record up to its checksum
+uint32_t HighScores::checksum(const scoreRecord &record) {
+	const uint8_t *bytes = (const uint8_t*) &record;
+	uint32_t crc = 0xFFFFFFFF;
+
+	for (size_t i = 0; i < offsetof(scoreRecord, checksum); i++) {
+		crc ^= bytes[i];
+		for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+	}
+
+	return ~crc;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "game.h"
+
+/// One finished game. The checksum covers everything before it, so a record cut short by a crash is found and dropped
+struct scoreRecord {
+	uint64_t mode;
+	uint32_t score, lines, level;
+	uint32_t ticks, shapes;
+	uint32_t time; // Unix time the game ended
+	char name[12]; // NUL terminated
+	uint32_t checksum;
+};
+
+/// Best scores of every mode. The file is a log that finished games are appended to, and only the best topCount of each mode are kept in memory.
+/// Scores that fell out of every top list are dropped by compacting the log, so every game is also appended to a stats log that is never compacted or read back.
+/// All writing happens on a background thread, so add() never waits on the disk
+class HighScores {
+public:
+	static const int topCount = 10;
+
+	/// Standard games are told apart by starting level, custom games by their settings
+	static uint64_t standardMode(int level);
+	static uint64_t customMode(const gameSettings &settings);
+	static bool isCustomMode(uint64_t mode);
+
+	~HighScores();
+
+	/// Reads the whole log, cutting off a damaged or partly written end. Only the end of the stats log at statsPath is checked.
+	/// legacyPath is the old "score name" text file, imported when there is no log yet
+	bool load(const char *logPath, const char *statsPath = NULL, const char *legacyPath = NULL);
+	/// Queues the game to be appended to the log, compacting it once most of it is scores no top list has any more
+	void add(uint64_t mode, const std::string &name, const Game &game);
+	/// Waits for everything queued to be on disk and stops the writer
+	void close();
+
+	/// Best first. Empty for a mode nothing was scored in
+	const std::vector<scoreRecord> &top(uint64_t mode) const;
+	/// Every mode with a score, standard ones first
+	std::vector<uint64_t> modes() const;
+
+	void compact();
+
+private:
+	static const uint32_t magic = 0x53594C50; // "PLYS"
+	static const uint32_t statsMagic = 0x54534C50; // "PLST"
+	static const uint32_t version = 1;
+	static const int headerSize = 8;
+
+	struct writeJob {
+		bool compact;
+		std::vector<scoreRecord> records;
+	};
+
+	std::string path, statsPath;
+	std::unordered_map<uint64_t, std::vector<scoreRecord>> tops;
+	/// Records in the log, kept or not
+	size_t logged = 0;
+
+	std::thread writer;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<writeJob> jobs;
+	bool stopping = false;
+	FILE *log = NULL, *statsLog = NULL; // Only used on the writer thread
+
+	void insert(const scoreRecord &record);
+	size_t kept() const;
+
+	void queue(writeJob job);
+	void writeLoop();
+	void recoverStats();
+	bool append(FILE *&file, const std::string &filePath, uint32_t fileMagic, const std::vector<scoreRecord> &records);
+	bool rewrite(const std::vector<scoreRecord> &records);
+	static uint32_t checksum(const scoreRecord &record);
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+/// Position of one tile of a shape orientation, relative to the shape's x and y
+struct cellOffset {
+	int8_t x, y;
+};
+
+/// Board kernels. W, H and N (board width, height and tiles per shape) are read from the arguments when 0.
+/// Standard games call them with 10, 22 and 4, which turns every loop into straight line code with a constant row stride
+
+template <int W = 0, int H = 0, int N = 0>
+inline bool fits(const uint8_t *cells, int width, int height, const cellOffset *shape, int count, int x, int y) {
+	if (W) width = W;
+	if (H) height = H;
+	if (N) count = N;
+
+	for (int i = 0; i < count; i++) {
+		int cx = x + shape[i].x, cy = y + shape[i].y;
+		if ((unsigned) cx >= (unsigned) width || (unsigned) cy >= (unsigned) height || cells[cy * width + cx]) return false;
+	}
+	return true;
+}
+
+/// Lowest y the shape can drop to from y, following each tile down its column and keeping the shortest fall
+template <int W = 0, int H = 0, int N = 0>
+inline int landingY(const uint8_t *cells, int width, int height, const cellOffset *shape, int count, int x, int y) {
+	if (W) width = W;
+	if (H) height = H;
+	if (N) count = N;
+
+	int distance = height;
+
+	for (int i = 0; i < count; i++) {
+		int cx = x + shape[i].x, cy = y + shape[i].y;
+
+		int d = 0;
+		while (d < distance && cy + d + 1 < height && !cells[(cy + d + 1) * width + cx]) d++;
+		distance = d;
+	}
+
+	return y + distance;
+}
+
+/// Line clear for boards without walls: full rows are dropped and everything above moves down
+template <int W = 0, int H = 0>
+inline int clearFullRows(uint8_t *cells, int width, int height) {
+	if (W) width = W;
+	if (H) height = H;
+
+	int cleared = 0;
+
+	for (int y = height - 1; y >= 0; y--) {
+		const uint8_t *row = cells + y * width;
+
+		int x = 0;
+		while (x < width && row[x]) x++;
+
+		if (x == width) cleared++;
+		else if (cleared > 0) std::memcpy(cells + (y + cleared) * width, row, width);
+	}
+
+	std::memset(cells, 0, cleared * width);
+	return cleared;
+}
+
+/// The seven tetrominoes in every orientation, built at compile time in the same order and with the same clockwise rotation as Shape::init
+struct tetrominoTable {
+	cellOffset cells[7][4][4];
+};
+
+constexpr tetrominoTable buildTetrominoes() {
+	/// Bounding box size and rows (bit x of a row is column x) of each tetromino, matching Shape::shapes
+	const int sizes[7] = {4, 3, 3, 2, 3, 3, 3};
+	const int rows[7][4] = {
+		{0b0000, 0b1111, 0b0000, 0b0000},
+		{0b001, 0b111, 0b000},
+		{0b100, 0b111, 0b000},
+		{0b11, 0b11},
+		{0b110, 0b011, 0b000},
+		{0b010, 0b111, 0b000},
+		{0b011, 0b110, 0b000}
+	};
+
+	tetrominoTable table = {};
+
+	for (int s = 0; s < 7; s++) {
+		int n = sizes[s];
+
+		for (int r = 0; r < 4; r++) {
+			int i = 0;
+
+			for (int y = 0; y < n; y++) {
+				for (int x = 0; x < n; x++) {
+					/// Undo r clockwise turns to find the tile this cell came from, rot[y][x] = prev[n - 1 - x][y]
+					int px = x, py = y;
+					for (int t = 0; t < r; t++) {
+						int ox = px;
+						px = py;
+						py = n - 1 - ox;
+					}
+
+					if ((rows[s][py] >> px) & 1) table.cells[s][r][i++] = {(int8_t) x, (int8_t) y};
+				}
+			}
+		}
+	}
+
+	return table;
+}
+
+constexpr tetrominoTable tetrominoes = buildTetrominoes();
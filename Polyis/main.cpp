@@ -5,8 +5,10 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
-#include <direct.h>
+#include <climits>
+#include <cstring>
 #include <iterator>
 #include <random>
 #include <stdio.h>
@@ -14,19 +16,23 @@
 #include <unordered_set>
 #include <vector>
 
-#include "Shape.h"
-#include "Text.h"
+#include "archive.h"
+#include "bot.h"
+#include "game.h"
+#include "highScores.h"
+#include "netplay.h"
+#include "profiler.h"
+#include "replay.h"
+#include "settings.h"
+#include "shape.h"
+#include "sound.h"
+#include "text.h"
+#include "versus.h"
 
 typedef std::vector<int> intArray;
 typedef std::vector<float> floatArray;
-typedef std::vector<std::vector<Tile>> gridArray;
 typedef std::vector<Text> textArray;
 
-enum fallState {
-	FELL,
-	PLACED,
-};
-
 enum gameState {
 	PLAYING,
 	ENDED,
@@ -35,13 +41,29 @@ enum gameState {
 };
 
 bool handleEvents();
+void resize();
 bool update(float deltaTime);
 void paintGame();
+void paintGridShape(bool walls);
+SDL_Rect boardRect(int x, int y, int w = 1, int h = 1);
+void turnWithGravity(float x, float y, float w, float h, int cols, int rows, float &left, float &top, float &right, float &bottom);
+void viewSize(int &cols, int &rows);
+SDL_Rect viewRect();
+void visibleCells(int &x0, int &y0, int &x1, int &y1);
+void updateCamera(float deltaTime);
+void paintGridLine(const SDL_Rect &edge);
+void paintMinimap();
+void clearMinimap();
+void paintOpponents(const Versus &match, int local);
 void paintMenu(float deltaTime);
 
-fallState fall();
-void addShape();
-void newShape();
+SDL_Texture *getPreview(int index, int tileSize);
+void clearPreviews();
+
+void handleGameEvents();
+void playerInput(gameInput input);
+void endGame();
+void saveReplay();
 
 void refreshText();
 
@@ -49,44 +71,57 @@ void beginGame(int lvl = 1, bool customLevel = false);
 void pauseGame(bool pause = true);
 void returnToMenu();
 
+std::string settingKey(std::string label);
+void addSettings();
 void saveSettings();
 void loadSettings();
 
-void saveScores();
-void loadScores();
+void changeScoreMode(int step);
 
 bool init();
+SDL_RWops *openResource(const char *name);
+int loadAssets(void *data);
+void finishLoading();
 void initSettings(bool load);
 
-bool godDammitEthanWhyDidYouNameTheSoundGameOver();
 void close();
 
 SDL_Window *window;
 SDL_Renderer *renderer;
 
 Mix_Music *korobeinki;
-Mix_Chunk *move, *rotate, *clear, *difficult, *placed, *gameOver;
 
-Text scoreT, scoreNumT, linesT, linesNumT, levelT, levelNumT, nextT, menuT, holdT;
+Settings settingsStore;
+
+/// resources.pak when there is one, otherwise everything is read from the resources directory
+Archive resources;
+
+/// Audio and the icon load on loadingThread while the menu is already up. Nothing it touches is used before finishLoading()
+SDL_Thread *loadingThread = NULL;
+std::atomic<bool> assetsLoaded(false);
+Mix_Music *loadedMusic = NULL;
+SDL_Surface *loadedIcon = NULL;
+Uint64 startCounter = 0;
+float audioOpenTime = 0.0F, soundsTime = 0.0F, musicTime = 0.0F, iconTime = 0.0F, firstFrameTime = 0.0F;
+
+Text scoreT, scoreNumT, linesT, linesNumT, levelT, levelNumT, nextT, menuT, holdT, livesT;
 
 int tileLength = 34, tiles = 4, width = 10, height = 22, gridLineWidth = 2, wdx = 0, wdy = 0;
 int screenWidth = tileLength * (width + 12), screenHeight = tileLength * (height - 2);
 
 int selectedMenuIndex = 0, selectedSubmenuIndex = 0, selectedEndMenuIndex = 0;
 
-Shape *currentShape;
-intArray shapeIndexes;
-intArray nextShapeIndexes;
-int currentShapeIndex = 0, heldIndex = -1;
-gridArray grid(height, std::vector<Tile>(width));
+/// The game the player controls, soloGame or the first board of a versus match
+Game soloGame, *game = &soloGame;
+/// Time not yet simulated, the game only moves in whole ticks
+float tickTime = 0.0F;
 
-unsigned int score = 0, lines = 0, level = 1, lineClearCombos = 0, startingLevel = 1;
-floatArray lineClearPoints = {100, 300, 500, 800, 1.5, 50};
-bool lastClearDifficult = false;
+/// Games are recorded when started with --record directory, for replaying headlessly with polyis-replay
+Replay replay;
+std::string replayDirectory;
 
-float fastSpeed = 30.0F, normalSpeed = (float) level, fastFallTime = 0.0F, normalFallTime = 0.0F, lockTime = 0.0F, lockDelay = .25F;
-int nextShapes = 3; // No more than 7
-bool isFast = false, canHold = true, isLocking = false, menuFocus = true, debugShowDataArea = false, isCustom = false;
+int nextShapes = 3; // No more than ShapeQueue::capacity
+bool menuFocus = true, debugShowDataArea = false, isCustom = false, resizePending = false;
 
 gameState state = MAIN_MENU;
 
@@ -117,6 +152,28 @@ struct customOption {
 	std::vector<std::string> strings;
 } custom[11], options[4];
 
+/// Values the settings file may give an option
+void optionRange(const customOption &option, int &min, int &max) {
+	switch (option.type) {
+	case BOOLEAN:
+		min = 0;
+		max = 1;
+		break;
+	case INTEGER:
+		min = option.Imin;
+		max = option.Imax;
+		break;
+	case FLOAT: // Stored as the power of two
+		min = (int) log2(option.Fmin);
+		max = (int) log2(option.Fmax);
+		break;
+	case STRING:
+		min = 0;
+		max = (int) option.strings.size() - 1;
+		break;
+	}
+}
+
 std::vector<textArray> highscores;
 
 Text customPlay, resetControls;
@@ -127,14 +184,59 @@ struct controlOption {
 } controls[9];
 int currentEditingIndex = -1;
 
-struct scoreEntry {
-	std::string name;
-	int score;
-	Text nameT, scoreT;
-};
-std::vector<scoreEntry*> scoreEntries;
+/// Scores menu shows the top list of one mode at a time, with a Text per row rather than per score
+HighScores highScores;
+uint64_t scoreMode = HighScores::standardMode(1);
+Text scoreModeT;
+std::array<Text, HighScores::topCount> scoreNameT, scoreValueT;
+
+/// Next and hold panel shapes, each drawn once into its own texture at previewTileSize
+std::vector<SDL_Texture*> previews;
+int previewTileSize = 0;
+
+/// Top left cell in view, counted from the first visible row. Follows the current shape on boards bigger than the play area
+float cameraX = 0.0F, cameraY = 0.0F;
+
+/// Whole board shrunk to at most minimapSize texels across, rebuilt only when the board changes
+SDL_Texture *minimap = NULL;
+std::vector<Uint32> minimapPixels;
+int minimapWidth = 0, minimapHeight = 0, minimapScale = 1;
+bool minimapDirty = true;
+const int minimapSize = 128;
+
+/// Started with --versus players, the player takes on bots on boards that tick in lockstep with theirs
+Versus versus;
+std::vector<Bot> bots;
+int versusPlayers = 1;
+bool versusWon = false;
+
+/// Started with --host port or --join address port, the player takes on someone else over UDP instead
+Netplay netplay;
+bool netplayMode = false;
+std::string netplayAddress;
+int netplayPort = 0;
 
 int main(int argc, char *argv[]) {
+	startCounter = SDL_GetPerformanceCounter();
+
+	for (int i = 1; i + 1 < argc; i++) {
+		if (strcmp(argv[i], "--record") == 0) replayDirectory = argv[++i];
+		else if (strcmp(argv[i], "--audio-buffer") == 0) Sound::bufferSize = std::max(64, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--versus") == 0) versusPlayers = std::max(1, std::min(Versus::maxPlayers, atoi(argv[++i])));
+		else if (strcmp(argv[i], "--host") == 0) netplayPort = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--join") == 0 && i + 2 < argc) {
+			netplayAddress = argv[++i];
+			netplayPort = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--net-delay") == 0) netplay.inputDelay = std::max(0, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--net-shim") == 0 && i + 3 < argc) { // Latency and jitter in ms, loss in percent
+			int latency = atoi(argv[++i]), jitter = atoi(argv[++i]);
+			netplay.socket.simulate(latency, jitter, (float) atof(argv[++i]) / 100);
+		}
+	}
+	netplayMode = netplayPort > 0;
+	if (netplayMode) versusPlayers = 1;
+
 	init();
 
 	Uint32 lastTime, currentTime = SDL_GetTicks();
@@ -160,75 +262,46 @@ bool handleEvents() {
 		switch (e.type) {
 		case SDL_QUIT:
 			return false;
+		case SDL_RENDER_TARGETS_RESET: // Render target contents are lost, so the previews have to be drawn again
+			clearPreviews();
+			break;
 		case SDL_WINDOWEVENT:
 			if ((e.window.event == SDL_WINDOWEVENT_MOVED || e.window.event == SDL_WINDOWEVENT_FOCUS_LOST || e.window.event == SDL_WINDOWEVENT_RESIZED) && state == PLAYING) {
 				pauseGame(true);
 			}
 
 			if (e.window.event == SDL_WINDOWEVENT_RESIZED) {
-				SDL_GetWindowSize(window, &screenWidth, &screenHeight);
-
-				float width = (float) screenWidth, height = (float) screenHeight;
-				
-				tileLength = (int) std::min(width / 22.0F, height / 20.0F);
-				Text::defaultSize = tileLength;
-				gridLineWidth = std::max(1, tileLength / 12);
-
-				wdx = (screenWidth - (tileLength * 22)) / 2;
-				wdy = (screenHeight - (tileLength * 20)) / 2;
-
-				printf("%i, %i, %i, %i, %f\n", screenWidth, screenHeight, wdx, wdy, (float) tileLength * 0.6F);
-
-				refreshText();
+				resizePending = true; // Dragging the window sends a stream of these, only the last one of the frame is handled
 			}
 			break;
 		case SDL_KEYDOWN:
+			if (e.key.keysym.sym == controls[8].key && !(state == MAIN_MENU && currentEditingIndex >= 0)) {
+				Profiler::visible = !Profiler::visible;
+			}
+
 			switch (state) {
 			case PLAYING:
 				if (e.key.keysym.sym == controls[0].key || e.key.keysym.sym == controls[1].key) {
-					if (currentShape->move(grid, e.key.keysym.sym == controls[1].key)) {
-						lockTime = 0;
-						Mix_PlayChannel(-1, move, 0);
-					}
+					bool right = e.key.keysym.sym == controls[1].key;
+					if (game->settings.gravity == FALL_UP || game->settings.gravity == FALL_RIGHT) right = !right; // Keep left/right (or up/down when sideways) matching the screen
+
+					playerInput(right ? MOVE_RIGHT : MOVE_LEFT);
 				}
 
 				if (e.key.keysym.sym == controls[4].key || e.key.keysym.sym == controls[5].key) {
-					if (currentShape->rotate(grid, e.key.keysym.sym == controls[4].key)) {
-						lockTime = 0;
-						Mix_PlayChannel(-1, rotate, 0);
-					}
+					playerInput(e.key.keysym.sym == controls[4].key ? ROTATE_CLOCKWISE : ROTATE_COUNTERCLOCKWISE);
 				}
 
 				if (e.key.keysym.sym == controls[2].key && e.key.repeat == 0) {
-					isFast = true;
+					playerInput(SOFT_DROP);
 				}
 
 				if (e.key.keysym.sym == controls[3].key && e.key.repeat == 0) {
-					while (fall() == FELL) {
-						score += 2;
-						scoreNumT.change(std::to_string(score));
-					}
-					lockTime = lockDelay;
+					playerInput(HARD_DROP);
 				}
 
-				if (e.key.keysym.sym == controls[6].key && canHold) {
-					int p = currentShapeIndex;
-					bool first = heldIndex == -1;
-					if (first) newShape(); else currentShapeIndex = heldIndex;
-					heldIndex = p;
-
-					if (!first) {
-						if (currentShape != NULL) delete currentShape;
-						currentShape = new Shape;
-
-						currentShape->data = Shape::shapes[currentShapeIndex];
-						currentShape->x = (grid[0].size() - currentShape->data.size()) / 2;
-
-						godDammitEthanWhyDidYouNameTheSoundGameOver();
-						isFast = false;
-					}
-
-					canHold = false;
+				if (e.key.keysym.sym == controls[6].key) {
+					playerInput(HOLD);
 				}
 
 				if (e.key.keysym.sym == controls[7].key || e.key.keysym.sym == SDLK_ESCAPE) {
@@ -353,6 +426,10 @@ bool handleEvents() {
 						}
 					}
 
+					if ((e.key.keysym.sym == SDLK_LEFT || e.key.keysym.sym == SDLK_RIGHT) && menuFocus && selectedMenuIndex == 4) {
+						changeScoreMode(e.key.keysym.sym == SDLK_RIGHT ? 1 : -1);
+					}
+
 					if (e.key.keysym.sym == SDLK_LEFT && !menuFocus) {
 						switch (selectedMenuIndex) {
 						case 0:
@@ -457,17 +534,9 @@ bool handleEvents() {
 						case 2:
 							switch (currentEditingIndex) { // Apply Options
 							case 0:
-								Mix_VolumeMusic((128 * options[0].currentOption * options[1].currentOption) / 10000);
-							case 2:
-								Mix_VolumeChunk(move, (128 * options[0].currentOption * options[2].currentOption) / 10000);
-								Mix_VolumeChunk(rotate, (128 * options[0].currentOption * options[2].currentOption) / 10000);
-								Mix_VolumeChunk(clear, (128 * options[0].currentOption * options[2].currentOption) / 10000);
-								Mix_VolumeChunk(difficult, (128 * options[0].currentOption * options[2].currentOption) / 10000);
-								Mix_VolumeChunk(placed, (128 * options[0].currentOption * options[2].currentOption) / 10000);
-								Mix_VolumeChunk(gameOver, (128 * options[0].currentOption * options[2].currentOption) / 10000);
-								break;
 							case 1:
-								Mix_VolumeMusic((128 * options[0].currentOption * options[1].currentOption) / 10000);
+							case 2:
+								Sound::setVolume(options[0].currentOption, options[1].currentOption, options[2].currentOption);
 								break;
 							//case 3:
 							//	tileLength = options[3].currentOption;
@@ -511,7 +580,7 @@ bool handleEvents() {
 						returnToMenu();
 						break;
 					case 1:
-						beginGame(startingLevel, isCustom);
+						beginGame(game->settings.startingLevel, isCustom);
 						break;
 					default:
 						break;
@@ -531,47 +600,111 @@ bool handleEvents() {
 			break;
 		case SDL_KEYUP:
 			if (e.key.keysym.sym == controls[2].key) {
-				isFast = false;
+				playerInput(SOFT_DROP_RELEASE);
 			}
 		default:
 			break;
 		}
 	}
 
+	if (resizePending) {
+		resizePending = false;
+		resize();
+	}
+
 	return true;
 }
 
+/// Recalculates the layout for the current window size. Text and previews are only marked for a new size here and get rasterized when they're next painted
+void resize() {
+	SDL_GetWindowSize(window, &screenWidth, &screenHeight);
+
+	float width = (float) screenWidth, height = (float) screenHeight;
+
+	tileLength = (int) std::min(width / 22.0F, height / 20.0F);
+	Text::defaultSize = tileLength;
+	gridLineWidth = std::max(1, tileLength / 12);
+
+	wdx = (screenWidth - (tileLength * 22)) / 2;
+	wdy = (screenHeight - (tileLength * 20)) / 2;
+
+	refreshText();
+	clearPreviews();
+}
+
 bool update(float deltaTime) {
+	Text::newFrame();
+	Profiler::newFrame();
+
+	if (netplayMode) {
+		netplay.poll();
+
+		if (netplay.started && (width != game->settings.width || height != game->settings.height)) { // The host's settings arrived
+			width = game->settings.width;
+			height = game->settings.height;
+			updateCamera(-1);
+			clearMinimap();
+		}
+	}
+
 	if (state == PLAYING) {
-		if (isLocking) {
-			lockTime += deltaTime;
-			if (lockTime >= lockDelay) {
-				addShape();
-				isLocking = false;
-				lockTime = 0;
-			} else if (currentShape->fall(grid, false)) {
-				isLocking = false;
-				lockTime = 0;
-			}
-		} else {
-			(isFast ? fastFallTime : normalFallTime) += deltaTime;
+		PROFILE_SCOPE(SIMULATION);
 
-			if ((isFast ? fastFallTime : normalFallTime) >= 1 / (isFast ? fastSpeed : normalSpeed)) {
-				(isFast ? fastFallTime : normalFallTime) -= 1 / (isFast ? fastSpeed : normalSpeed);
-				if (isFast) {
-					score++;
-					scoreNumT.change(std::to_string(score));
-				}
+		tickTime = std::min(tickTime + deltaTime, 0.25F); // Long stalls (like dragging the window) are not caught up on
+		while (tickTime >= Game::tickLength) {
+			tickTime -= Game::tickLength;
 
-				fall();
+			if (netplayMode) {
+				if (!netplay.update()) { // Waiting on the other player, the time is not caught up on later
+					tickTime = 0.0F;
+					break;
+				}
+			} else if (versusPlayers > 1) {
+				for (int n = 1; n < versus.games.size(); n++) {
+					int input = bots[n].next(versus.games[n]);
+					if (input >= 0) versus.games[n].input((gameInput) input);
+				}
+				versus.update();
+			} else {
+				game->update();
 			}
 		}
+
+		if (versusPlayers > 1 && !game->ended && versus.winner() == 0) {
+			versusWon = true;
+			game->ended = true;
+			endGame();
+		}
+
+		if (netplayMode && netplay.ended()) {
+			versusWon = netplay.winner() == netplay.player;
+			endGame();
+		}
+
+		updateCamera(deltaTime);
+	}
+
+	if (loadingThread != NULL && assetsLoaded) finishLoading();
+
+	handleGameEvents();
+	Sound::flush();
+
+	{
+		PROFILE_SCOPE(RENDER);
+
+		if (state == MAIN_MENU) paintMenu(deltaTime);
+		else paintGame();
 	}
 
-	if (state == MAIN_MENU) paintMenu(deltaTime);
-	else paintGame();
+	Profiler::paint(renderer, tileLength / 2, tileLength / 2, tileLength);
 
 	SDL_RenderPresent(renderer);
+
+	if (firstFrameTime == 0.0F) {
+		firstFrameTime = (float) (SDL_GetPerformanceCounter() - startCounter) * 1000 / SDL_GetPerformanceFrequency();
+		printf("Startup: first frame after %.1fms\n", firstFrameTime);
+	}
+
 	return true;
 }
 
@@ -580,69 +713,72 @@ void paintGame() {
 	SDL_RenderClear(renderer);
 
 	if (state != PAUSED) {
+		SDL_Rect view = viewRect();
+		view = {view.x - gridLineWidth / 2, view.y - gridLineWidth / 2, view.w + gridLineWidth, view.h + gridLineWidth};
+		SDL_RenderSetClipRect(renderer, &view);
+
+		int x0, y0, x1, y1;
+		visibleCells(x0, y0, x1, y1);
+
 		int one = state == ENDED ? 208 : 64;
 		SDL_SetRenderDrawColor(renderer, one, one, one, 255);
-		SDL_Rect game = {wdx + tileLength * 6, wdy, tileLength * 10, tileLength * 20};
-		SDL_RenderFillRect(renderer, &game);
+		if (game->grid.rectangular) {
+			SDL_Rect board = boardRect(0, 2, width, height - 2);
+			Profiler::fillRect(renderer, &board);
+		} else {
+			paintGridShape(false);
+		}
 
 		if (options[3].currentOption == 1) { // Only if "Ghost Piece" option is enabled
-			int ghostY = currentShape->y;
-			bool stop = false;
-			do {
-				ghostY++;
-				for (int y = 0; y < currentShape->data.size() && !stop; y++) {
-					for (int x = 0; x < currentShape->data.size() && !stop; x++) {
-						if (currentShape->data[y][x].exists) {
-							stop = (ghostY + y > 21 || grid[ghostY + y][currentShape->x + x].exists);
-						}
-					}
-				}
-			} while (!stop);
+			int ghostY = game->currentShape.landingY(game->grid);
 
-			for (int y = 0; y < currentShape->data.size(); y++) { // Paint ghost
-				for (int x = 0; x < currentShape->data.size(); x++) {
-					if (currentShape->data[y][x].exists) {
-						SDL_Rect tile = {wdx + tileLength * (x + currentShape->x + 6), wdy + tileLength * (y - 3 + ghostY), tileLength, tileLength};
+			for (int y = 0; y < game->currentShape.data().size(); y++) { // Paint ghost
+				if (ghostY + y <= 1) continue;
+				for (int x = 0; x < game->currentShape.data().size(); x++) {
+					if (game->currentShape.data()[y][x]) {
+						SDL_Rect tile = boardRect(x + game->currentShape.x, y + ghostY);
 						SDL_SetRenderDrawColor(renderer, 96, 96, 96, 255);
-						SDL_RenderFillRect(renderer, &tile);
+						Profiler::fillRect(renderer, &tile);
 					}
 				}
 			}
 		}
 
-		for (int y = 2; y < height; y++) { // Paint grid
-			for (int x = 0; x < width; x++) {
-				if (grid[y][x].exists) {
-					SDL_Rect tile = {wdx + tileLength * (x + 6), wdy + tileLength * (y - 2), tileLength, tileLength};
+		for (int y = y0; y < y1; y++) { // Paint grid
+			for (int x = x0; x < x1; x++) {
+				if (game->grid[y][x] && game->grid[y][x] != Board::WALL) {
+					SDL_Rect tile = boardRect(x, y);
+					const Color &color = Shape::palette[game->grid[y][x]];
 					if (state == PLAYING) {
-						SDL_SetRenderDrawColor(renderer, grid[y][x].r, grid[y][x].g, grid[y][x].b, 255);
+						SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255);
 					} else {
-						SDL_SetRenderDrawColor(renderer, (grid[y][x].r + 765) / 4, (grid[y][x].g + 765) / 4, (grid[y][x].b + 765) / 4, 255);
+						SDL_SetRenderDrawColor(renderer, (color.r + 765) / 4, (color.g + 765) / 4, (color.b + 765) / 4, 255);
 					}
-					SDL_RenderFillRect(renderer, &tile);
+					Profiler::fillRect(renderer, &tile);
 				}
 			}
 		}
 
-		for (int y = 0; y < currentShape->data.size(); y++) { // Paint shape
-			if (currentShape->y + y <= 1) continue;
-			for (int x = 0; x < currentShape->data.size(); x++) {
-				if (!currentShape->data[y][x].exists && !debugShowDataArea) continue;
+		for (int y = 0; y < game->currentShape.data().size(); y++) { // Paint shape
+			if (game->currentShape.y + y <= 1) continue;
+			for (int x = 0; x < game->currentShape.data().size(); x++) {
+				if (!game->currentShape.data()[y][x] && !debugShowDataArea) continue;
 
-				SDL_Rect tile = {wdx + tileLength * (x + currentShape->x + 6), wdy + tileLength * (y - 2 + currentShape->y), tileLength, tileLength};
+				SDL_Rect tile = boardRect(x + game->currentShape.x, y + game->currentShape.y);
 
 				if (debugShowDataArea)
 					SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
 
-				if (currentShape->data[y][x].exists || !debugShowDataArea) {
+				if (game->currentShape.data()[y][x] || !debugShowDataArea) {
+					const Color &color = Shape::palette[game->currentShape.data()[y][x]];
 					if (state == PLAYING) {
-						SDL_SetRenderDrawColor(renderer, (Uint8) ((1 - (lockTime / lockDelay)) * currentShape->data[y][x].r + (72 * (lockTime / lockDelay))), (Uint8) ((1 - (lockTime / lockDelay)) * currentShape->data[y][x].g + (72 * (lockTime / lockDelay))), (Uint8) ((1 - (lockTime / lockDelay)) * currentShape->data[y][x].b + (72 * (lockTime / lockDelay))), 255);
+						SDL_SetRenderDrawColor(renderer, (Uint8) ((1 - (game->lockTime / game->lockDelay)) * color.r + (72 * (game->lockTime / game->lockDelay))), (Uint8) ((1 - (game->lockTime / game->lockDelay)) * color.g + (72 * (game->lockTime / game->lockDelay))), (Uint8) ((1 - (game->lockTime / game->lockDelay)) * color.b + (72 * (game->lockTime / game->lockDelay))), 255);
 					} else {
-						SDL_SetRenderDrawColor(renderer, (currentShape->data[y][x].r + 765) / 4, (currentShape->data[y][x].g + 765) / 4, (currentShape->data[y][x].b + 765) / 4, 255);
+						SDL_SetRenderDrawColor(renderer, (color.r + 765) / 4, (color.g + 765) / 4, (color.b + 765) / 4, 255);
 					}
 				}
 
-				SDL_RenderFillRect(renderer, &tile);
+				Profiler::fillRect(renderer, &tile);
 			}
 		}
 
@@ -650,49 +786,54 @@ void paintGame() {
 
 		SDL_SetRenderDrawColor(renderer, two, two, two, 255);
 
-		for (int x = 0; x <= width; x++) {
-			SDL_Rect line = {wdx + tileLength * (6 + x) - gridLineWidth / 2, wdy, gridLineWidth, tileLength * 20};
-			SDL_RenderFillRect(renderer, &line);
-		}
+		for (int x = x0; x <= x1; x++) paintGridLine(boardRect(x, y0, 0, y1 - y0));
+		for (int y = y0; y <= y1; y++) paintGridLine(boardRect(x0, y, x1 - x0, 0));
 
-		for (int y = 0; y < height - 1; y++) {
-			SDL_Rect line = {wdx + tileLength * 6, wdy + tileLength * y - gridLineWidth / 2, tileLength * 10, gridLineWidth};
-			SDL_RenderFillRect(renderer, &line);
+		if (!game->grid.rectangular) { // Cover the grid lines outside of the grid shape
+			SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+			paintGridShape(true);
 		}
+
+		SDL_RenderSetClipRect(renderer, NULL);
 	}
 
-	if (state != PLAYING) {
+	bool waiting = netplayMode && !netplay.started;
+
+	if (state != PLAYING || waiting) {
 		if (state == ENDED) {
 			SDL_SetRenderDrawColor(renderer, 64, 64, 64, 255);
 			SDL_Rect pauseBox = {wdx + (int) (tileLength * 7.5), wdy + tileLength * 7, tileLength * 7, tileLength * 6};
-			SDL_RenderFillRect(renderer, &pauseBox);
+			Profiler::fillRect(renderer, &pauseBox);
 
 			for (int n = 0; n < 2; n++) {
 				if (selectedEndMenuIndex == n) {
 					SDL_Rect selection = {wdx + tileLength * 8, wdy + tileLength * (9.375 + 1.5 * n), tileLength * 6, tileLength * 1.5};
 					SDL_SetRenderDrawColor(renderer, 128, 0, 255, 255);
-					SDL_RenderFillRect(renderer, &selection);
+					Profiler::fillRect(renderer, &selection);
 				}
 				endOptions[n].paint(wdx + tileLength * 11, wdy + tileLength * (9.75 + 1.5 * n));
 			}
 		} else {
 			SDL_SetRenderDrawColor(renderer, 128, 128, 128, 255);
-			SDL_Rect bg = {wdx + tileLength * 6, wdy, tileLength * 10, tileLength * 20};
-			SDL_RenderFillRect(renderer, &bg);
+			SDL_Rect bg = boardRect(0, 2, width, height - 2), view = viewRect();
+			SDL_RenderSetClipRect(renderer, &view);
+			Profiler::fillRect(renderer, &bg);
+			SDL_RenderSetClipRect(renderer, NULL);
 		}
 
 		SDL_Color red = {255, 128, 128};
 		SDL_Color white = {255, 255, 255};
-		menuT.change(state == ENDED ? "Game Over" : "Paused", tileLength, state == ENDED ? red : white);
+		SDL_Color green = {128, 255, 128};
+		menuT.change(state == ENDED ? (versusWon ? "You Win" : "Game Over") : (state == PAUSED ? "Paused" : "Waiting"), tileLength, state == ENDED ? (versusWon ? green : red) : white);
 		menuT.paint(wdx + tileLength * 11, wdy + tileLength * 7.75);
 	}
 
 	//SDL_Rect bar = {0, 0, tileLength * 6, tileLength * 20};
 	//SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-	//SDL_RenderFillRect(renderer, &bar);
+	//Profiler::fillRect(renderer, &bar);
 
 	//bar = {tileLength * 16, 0, tileLength * 6, tileLength * 20};
-	//SDL_RenderFillRect(renderer, &bar);
+	//Profiler::fillRect(renderer, &bar);
 
 	scoreT.paint(wdx + tileLength * 3, wdy + tileLength / 2);
 	scoreNumT.paint(wdx + tileLength * 3, wdy + tileLength * 2);
@@ -710,70 +851,349 @@ void paintGame() {
 
 	SDL_Rect next = {wdx + (int) (tileLength * 16.5), wdy + (int) (tileLength * 2.5), tileLength * 5, tileLength * ((ceil(tiles / 2) + 1) * nextShapes)};
 	SDL_SetRenderDrawColor(renderer, 64, 64, 64, 255);
-	SDL_RenderFillRect(renderer, &next);
+	Profiler::fillRect(renderer, &next);
 
 	holdT.paint(wdx + tileLength * 3, wdy + tileLength * 11);
 
+	if (isCustom && custom[7].currentOption > 0) livesT.paint(wdx + tileLength * 3, wdy + (int) (tileLength * 18.75));
+
 	SDL_Rect hold = {wdx + tileLength / 2, wdy + (int) (tileLength * 12.5), tileLength * 5, tileLength * 5};
 	SDL_SetRenderDrawColor(renderer, 64, 64, 64, 255);
 
-	SDL_RenderFillRect(renderer, &hold);
+	Profiler::fillRect(renderer, &hold);
+
+	if (netplayMode) paintOpponents(netplay.current, netplay.player);
+	else if (versusPlayers > 1) paintOpponents(versus, 0);
+	else paintMinimap();
 
 	if (state != PAUSED) {
+		for (int n = 0; n < nextShapes; n++) { // Print next shapes
+			int nextShape = game->queue.peek(n);
 
-		int nextShapeIndex = shapeIndexes.size();
+			const gridArray &shape = Shape::shapes[nextShape];
 
-		for (unsigned x = 0; x < shapeIndexes.size(); x++) {
-			if (shapeIndexes[x] != -1) {
-				nextShapeIndex = x;
-				break;
-			}
+			float dx = 17.0F + (tiles - shape.size()) / 2.0F;//(nextShape == 0 || nextShape == 3 ? 17 : 17.5F);
+			float dy = 0;// (nextShape == 3 ? 1 : (nextShape == 0 ? 0.5F : 0));
+
+			SDL_Rect area = {wdx + (int) (tileLength * dx), wdy + (int) (tileLength * (3 - dy + (n * 3))), sideTile * (int) shape.size(), sideTile * (int) shape.size()};
+			Profiler::copy(renderer, getPreview(nextShape, sideTile), NULL, &area);
 		}
 
-		for (int n = 0; n < nextShapes; n++) { // Print next shapes
-			int nextShape;
-			gridArray shape;
-			if (nextShapeIndex + n >= (int) shapeIndexes.size()) {
-				nextShape = nextShapeIndexes[nextShapeIndex + n - shapeIndexes.size()];
-			} else {
-				nextShape = shapeIndexes[nextShapeIndex + n];
+		if (game->heldIndex >= 0) { // Paint held shape
+			const gridArray &shape = Shape::shapes[game->heldIndex];
+
+			float dx = 1.0F + (tiles - shape.size()) / 2.0F;//(heldIndex == 0 || heldIndex == 3 ? 1 : 1.5F);
+			float dy = 0;// (heldIndex == 3 ? 1 : (heldIndex == 0 ? 0.5F : 0));
+
+			SDL_Rect area = {wdx + (int) (tileLength * dx), wdy + (int) (tileLength * (14 - dy)), sideTile * (int) shape.size(), sideTile * (int) shape.size()};
+			Profiler::copy(renderer, getPreview(game->heldIndex, sideTile), NULL, &area);
+		}
+	}
+}
+
+/// Fills the visible cells inside (or outside, if walls is true) the grid shape with the current draw color, one rect per run
+void paintGridShape(bool walls) {
+	int x0, y0, x1, y1;
+	visibleCells(x0, y0, x1, y1);
+
+	for (int y = y0; y < y1; y++) {
+		int start = -1;
+
+		for (int x = x0; x <= x1; x++) {
+			if (x < x1 && game->grid.inMask(x, y) != walls) {
+				if (start < 0) start = x;
+			} else if (start >= 0) {
+				SDL_Rect run = boardRect(start, y, x - start);
+				Profiler::fillRect(renderer, &run);
+				start = -1;
 			}
+		}
+	}
+}
 
-			shape = Shape::shapes[nextShape];
+/// Screen area of a w by h block of board cells starting at (x, y), seen through the camera and turned to match the gravity direction
+SDL_Rect boardRect(int x, int y, int w, int h) {
+	int cols, rows;
+	viewSize(cols, rows);
 
-			float dx = 17.0F + (tiles - shape.size()) / 2.0F;//(nextShape == 0 || nextShape == 3 ? 17 : 17.5F);
-			float dy = 0;// (nextShape == 3 ? 1 : (nextShape == 0 ? 0.5F : 0));
+	float left, top, right, bottom;
+	turnWithGravity(x - cameraX, y - 2 - cameraY, (float) w, (float) h, cols, rows, left, top, right, bottom);
+
+	int x0 = (int) floor(left * tileLength), y0 = (int) floor(top * tileLength);
+	return {wdx + tileLength * 6 + x0, wdy + y0, (int) floor(right * tileLength) - x0, (int) floor(bottom * tileLength) - y0};
+}
+
+/// Edges of a w by h block of cells at (x, y) in a cols by rows area, after turning the area to match the gravity direction
+void turnWithGravity(float x, float y, float w, float h, int cols, int rows, float &left, float &top, float &right, float &bottom) {
+	left = x;
+	top = y;
+	right = x + w;
+	bottom = y + h;
+
+	switch (game->settings.gravity) {
+	case FALL_UP:
+		left = cols - (x + w);
+		right = cols - x;
+		top = rows - (y + h);
+		bottom = rows - y;
+		break;
+	case FALL_LEFT:
+		left = rows - (y + h);
+		right = rows - y;
+		top = x;
+		bottom = x + w;
+		break;
+	case FALL_RIGHT:
+		left = y;
+		right = y + h;
+		top = cols - (x + w);
+		bottom = cols - x;
+		break;
+	default:
+		break;
+	}
+}
+
+/// Board columns and visible rows that fit in the 10 by 20 tile play area (turned on its side for sideways gravity)
+void viewSize(int &cols, int &rows) {
+	bool sideways = game->settings.gravity == FALL_LEFT || game->settings.gravity == FALL_RIGHT;
+	cols = std::min(width, sideways ? 20 : 10);
+	rows = std::min(height - 2, sideways ? 10 : 20);
+}
+
+/// Screen area the board is drawn into
+SDL_Rect viewRect() {
+	int cols, rows;
+	viewSize(cols, rows);
+
+	float left, top, right, bottom;
+	turnWithGravity(0, 0, (float) cols, (float) rows, cols, rows, left, top, right, bottom);
+
+	return {wdx + tileLength * 6, wdy, tileLength * (int) right, tileLength * (int) bottom};
+}
+
+/// Board cells at least partly in view, from (x0, y0) up to but not including (x1, y1)
+void visibleCells(int &x0, int &y0, int &x1, int &y1) {
+	int cols, rows;
+	viewSize(cols, rows);
 
-			for (int y = 0; y < shape.size(); y++) {
-				for (int x = 0; x < shape.size(); x++) {
-					if (!shape[y][x].exists) continue;
-					SDL_Rect tile = {wdx + (int) (tileLength * dx + sideTile * x), wdy + (int) (tileLength * (3 - dy + (n * 3)) + sideTile * y), sideTile, sideTile};
+	x0 = std::max(0, (int) floor(cameraX));
+	y0 = std::max(2, 2 + (int) floor(cameraY));
+	x1 = std::min(width, (int) ceil(cameraX + cols));
+	y1 = std::min(height, 2 + (int) ceil(cameraY + rows));
+}
+
+/// Eases the camera towards the current shape (a negative deltaTime jumps straight there), keeping it inside the board
+void updateCamera(float deltaTime) {
+	int cols, rows;
+	viewSize(cols, rows);
+
+	float size = (float) game->currentShape.data().size();
+	float targetX = game->currentShape.x + size / 2 - cols / 2.0F;
+	float targetY = game->currentShape.y - 2 + size / 2 - rows / 3.0F; // More of the view below the shape than above
+	targetX = std::max(0.0F, std::min((float) (width - cols), targetX));
+	targetY = std::max(0.0F, std::min((float) (height - 2 - rows), targetY));
+
+	float t = deltaTime < 0 ? 1.0F : std::min(1.0F, deltaTime * 8);
+	cameraX += (targetX - cameraX) * t;
+	cameraY += (targetY - cameraY) * t;
+}
+
+/// Fills a grid line along a board edge (boardRect with a width or height of 0)
+void paintGridLine(const SDL_Rect &edge) {
+	SDL_Rect line = {edge.x, edge.y - gridLineWidth / 2, edge.w, gridLineWidth};
+	if (edge.w == 0) line = {edge.x - gridLineWidth / 2, edge.y, gridLineWidth, edge.h};
+	Profiler::fillRect(renderer, &line);
+}
+
+/// Paints the whole board shrunk into the lower right panel, with the camera and current shape marked. Only for boards bigger than the view
+void paintMinimap() {
+	int cols, rows;
+	viewSize(cols, rows);
+	if (cols == width && rows == height - 2) return;
+
+	SDL_Rect panel = {wdx + (int) (tileLength * 16.5), wdy + (int) (tileLength * 12.5), tileLength * 5, tileLength * 7};
+	SDL_SetRenderDrawColor(renderer, 64, 64, 64, 255);
+	Profiler::fillRect(renderer, &panel);
+
+	if (state == PAUSED) return;
 
-					SDL_SetRenderDrawColor(renderer, shape[y][x].r, shape[y][x].g, shape[y][x].b, 255);
-					SDL_RenderFillRect(renderer, &tile);
+	float left, top, boardW, boardH; // Size of the board on screen, in cells
+	turnWithGravity(0, 0, (float) width, (float) (height - 2), width, height - 2, left, top, boardW, boardH);
+
+	if (minimapDirty || minimap == NULL) {
+		if (minimap == NULL) {
+			minimapScale = (std::max((int) boardW, (int) boardH) + minimapSize - 1) / minimapSize;
+			minimapWidth = ((int) boardW + minimapScale - 1) / minimapScale;
+			minimapHeight = ((int) boardH + minimapScale - 1) / minimapScale;
+			minimap = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, minimapWidth, minimapHeight);
+			SDL_SetTextureBlendMode(minimap, SDL_BLENDMODE_BLEND);
+		}
+
+		// A texel takes the color of any filled cell in its block, then empty (dark) over walls (clear)
+		minimapPixels.assign(minimapWidth * minimapHeight, 0);
+		for (int y = 2; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				unsigned char cell = game->grid[y][x];
+				if (cell == Board::WALL) continue;
+
+				float right, bottom;
+				turnWithGravity((float) x, (float) (y - 2), 1, 1, width, height - 2, left, top, right, bottom);
+				Uint32 &texel = minimapPixels[((int) top / minimapScale) * minimapWidth + (int) left / minimapScale];
+
+				if (cell) {
+					const Color &color = Shape::palette[cell];
+					texel = 0xFF000000 | (color.r << 16) | (color.g << 8) | color.b;
+				} else if (texel == 0) {
+					texel = 0xFF202020;
 				}
 			}
 		}
 
-		if (heldIndex >= 0) { // Paint held shape
-			gridArray shape(tiles, std::vector<Tile>(tiles));
-			shape = Shape::shapes[heldIndex];
+		SDL_UpdateTexture(minimap, NULL, minimapPixels.data(), minimapWidth * sizeof(Uint32));
+		minimapDirty = false;
+	}
 
-			float dx = 1.0F + (tiles - shape.size()) / 2.0F;//(heldIndex == 0 || heldIndex == 3 ? 1 : 1.5F);
-			float dy = 0;// (heldIndex == 3 ? 1 : (heldIndex == 0 ? 0.5F : 0));
-			for (int y = 0; y < shape.size(); y++) {
-				for (int x = 0; x < shape.size(); x++) {
-					if (!shape[y][x].exists) continue;
-					SDL_Rect tile = {wdx + (int) (tileLength * dx + sideTile * x), wdy + (int) (tileLength * (14 - dy) + sideTile * y), sideTile, sideTile};
+	float scale = std::min(tileLength * 4.5F / boardW, tileLength * 6.5F / boardH); // Pixels per cell
+	float mapX = panel.x + (panel.w - boardW * scale) / 2, mapY = panel.y + (panel.h - boardH * scale) / 2;
+	SDL_Rect map = {(int) mapX, (int) mapY, (int) (boardW * scale), (int) (boardH * scale)};
+	Profiler::copy(renderer, minimap, NULL, &map);
+
+	float right, bottom;
+	const Shape &shape = game->currentShape;
+	turnWithGravity((float) shape.x, (float) (shape.y - 2), (float) shape.data().size(), (float) shape.data().size(), width, height - 2, left, top, right, bottom);
+	SDL_Rect marker = {(int) (mapX + left * scale), (int) (mapY + top * scale), std::max(2, (int) ((right - left) * scale)), std::max(2, (int) ((bottom - top) * scale))};
+	SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+	Profiler::fillRect(renderer, &marker);
+
+	turnWithGravity(cameraX, cameraY, (float) cols, (float) rows, width, height - 2, left, top, right, bottom);
+	SDL_Rect camera = {(int) (mapX + left * scale), (int) (mapY + top * scale), (int) ((right - left) * scale), (int) ((bottom - top) * scale)};
+	SDL_RenderDrawRect(renderer, &camera);
+}
 
-					SDL_SetRenderDrawColor(renderer, shape[y][x].r, shape[y][x].g, shape[y][x].b, 255);
-					SDL_RenderFillRect(renderer, &tile);
-				}
+void clearMinimap() {
+	if (minimap != NULL) SDL_DestroyTexture(minimap);
+	minimap = NULL;
+	minimapDirty = true;
+}
+
+/// Paints every board but local shrunk into the lower right panel, plus the garbage waiting for the player beside their board.
+/// Cells are gathered by color so each board takes one fill per color instead of one per cell
+void paintOpponents(const Versus &match, int local) {
+	static std::vector<SDL_Rect> buckets[9], walls;
+
+	SDL_Rect panel = {wdx + (int) (tileLength * 16.5), wdy + (int) (tileLength * 12.5), tileLength * 5, tileLength * 7};
+	SDL_SetRenderDrawColor(renderer, 64, 64, 64, 255);
+	Profiler::fillRect(renderer, &panel);
+
+	if (state == PAUSED || match.games.size() < 2) return;
+
+	if (game->incomingGarbage > 0) {
+		SDL_Rect view = viewRect();
+		int barHeight = std::min(view.h, (int) game->incomingGarbage * tileLength);
+		SDL_Rect bar = {view.x - tileLength / 4 - gridLineWidth, view.y + view.h - barHeight, tileLength / 4, barHeight};
+		SDL_SetRenderDrawColor(renderer, 255, 64, 64, 255);
+		Profiler::fillRect(renderer, &bar);
+	}
+
+	int opponents = (int) match.games.size() - 1;
+	int columns = std::min(opponents, 4), rows = (opponents + columns - 1) / columns;
+	float cellW = panel.w / (float) columns, cellH = panel.h / (float) rows;
+
+	float left, top, boardW, boardH; // Every board has the same settings, so the same size on screen
+	turnWithGravity(0, 0, (float) width, (float) (height - 2), width, height - 2, left, top, boardW, boardH);
+	float scale = std::min((cellW - 4) / boardW, (cellH - 4) / boardH); // Pixels per cell
+
+	for (int n = 0; n < opponents; n++) {
+		const Game &other = match.games[n < local ? n : n + 1];
+		float mapX = panel.x + cellW * (n % columns) + (cellW - boardW * scale) / 2;
+		float mapY = panel.y + cellH * (n / columns) + (cellH - boardH * scale) / 2;
+
+		for (int c = 0; c < 9; c++) buckets[c].clear();
+		walls.clear();
+
+		for (int y = 2; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				unsigned char cell = other.grid[y][x];
+
+				int shapeX = x - other.currentShape.x, shapeY = y - other.currentShape.y, size = (int) other.currentShape.data().size();
+				if (cell == 0 && shapeX >= 0 && shapeX < size && shapeY >= 0 && shapeY < size) cell = other.currentShape.data()[shapeY][shapeX];
+				if (cell == 0) continue;
+
+				float right, bottom;
+				turnWithGravity((float) x, (float) (y - 2), 1, 1, width, height - 2, left, top, right, bottom);
+				SDL_Rect tile = {(int) (mapX + left * scale), (int) (mapY + top * scale), std::max(1, (int) (mapX + right * scale) - (int) (mapX + left * scale)), std::max(1, (int) (mapY + bottom * scale) - (int) (mapY + top * scale))};
+
+				if (cell == Board::WALL) walls.push_back(tile);
+				else buckets[cell < 9 ? cell : 8].push_back(tile);
 			}
 		}
+
+		SDL_Rect board = {(int) mapX, (int) mapY, (int) (boardW * scale), (int) (boardH * scale)};
+		SDL_SetRenderDrawColor(renderer, 32, 32, 32, 255);
+		Profiler::fillRect(renderer, &board);
+
+		SDL_SetRenderDrawColor(renderer, 64, 64, 64, 255);
+		if (!walls.empty()) Profiler::fillRects(renderer, walls.data(), (int) walls.size());
+
+		for (int c = 1; c < 9; c++) {
+			if (buckets[c].empty()) continue;
+
+			const Color &color = Shape::palette[c];
+			int shade = other.ended ? 3 : 1; // Boards that topped out are dimmed
+			SDL_SetRenderDrawColor(renderer, color.r / shade, color.g / shade, color.b / shade, 255);
+			Profiler::fillRects(renderer, buckets[c].data(), (int) buckets[c].size());
+		}
 	}
 }
 
+SDL_Texture *getPreview(int index, int tileSize) {
+	if (tileSize != previewTileSize) {
+		clearPreviews();
+		previewTileSize = tileSize;
+	}
+
+	if (previews.size() != Shape::shapes.size()) {
+		clearPreviews();
+		previews.resize(Shape::shapes.size(), NULL);
+	}
+
+	if (previews[index] != NULL) return previews[index];
+
+	const gridArray &shape = Shape::shapes[index];
+	int size = std::max(1, tileSize * (int) shape.size());
+
+	SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, size, size);
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+	SDL_SetRenderTarget(renderer, texture);
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+	SDL_RenderClear(renderer);
+
+	for (int y = 0; y < shape.size(); y++) {
+		for (int x = 0; x < shape.size(); x++) {
+			if (!shape[y][x]) continue;
+			SDL_Rect tile = {tileSize * x, tileSize * y, tileSize, tileSize};
+
+			const Color &color = Shape::palette[shape[y][x]];
+			SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255);
+			Profiler::fillRect(renderer, &tile);
+		}
+	}
+
+	SDL_SetRenderTarget(renderer, NULL);
+
+	previews[index] = texture;
+	return texture;
+}
+
+void clearPreviews() {
+	for (int i = 0; i < previews.size(); i++) {
+		if (previews[i] != NULL) SDL_DestroyTexture(previews[i]);
+	}
+	previews.clear();
+}
+
 void paintMenu(float deltaTime) {
 	SDL_SetRenderDrawColor(renderer, 64, 64, 64, 255);
 	SDL_RenderClear(renderer);
@@ -826,7 +1246,7 @@ void paintMenu(float deltaTime) {
 		} else {
 			SDL_SetRenderDrawColor(renderer, 128, 0, 255, 255);
 		}
-		SDL_RenderFillRect(renderer, &box);
+		Profiler::fillRect(renderer, &box);
 	}
 
 	switch (selectedMenuIndex) {
@@ -837,7 +1257,7 @@ void paintMenu(float deltaTime) {
 				SDL_SetRenderDrawColor(renderer, 128, 0, 255, 255);
 			else
 				SDL_SetRenderDrawColor(renderer, 128, 128, 128, 255);
-			SDL_RenderFillRect(renderer, &box);
+			Profiler::fillRect(renderer, &box);
 
 			playOptions[n].paint(wdx + (int) (tileLength * 8.25 + tileLength * 3 * (n < 5 ? n : n - 5)), wdy + tileLength * 10 + (n < 5 ? 0 : tileLength * 3));
 		}
@@ -868,7 +1288,7 @@ void paintMenu(float deltaTime) {
 			if (n == currentEditingIndex) {
 				SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
 				SDL_Rect box = {wdx + (int) (tileLength * 19.9 - custom[n].valueText.getWidth()), wdy + (int) (tileLength * (4.9 + 1.25 * (float) n)), custom[n].valueText.getWidth() + (int) (tileLength * 0.3), (int) (tileLength * 0.95)};
-				SDL_RenderFillRect(renderer, &box);
+				Profiler::fillRect(renderer, &box);
 			}
 			custom[n].valueText.paint(wdx + tileLength * 20, wdy + (int) (tileLength * (5 + 1.25 * (float) n)), RIGHT);
 		}
@@ -895,7 +1315,7 @@ void paintMenu(float deltaTime) {
 			if (n == currentEditingIndex) {
 				SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
 				SDL_Rect box = {wdx + (int) (tileLength * 19.9 - options[n].valueText.getWidth()), wdx + (int) (tileLength * (4.9 + 1.25 * (float) n)), options[n].valueText.getWidth() + (int) (tileLength * 0.3), (int) (tileLength * 0.95)};
-				SDL_RenderFillRect(renderer, &box);
+				Profiler::fillRect(renderer, &box);
 			}
 			options[n].valueText.paint(wdx + tileLength * 20, wdy + (int) (tileLength * (5 + 1.25 * (float) n)), RIGHT);
 		}
@@ -924,12 +1344,22 @@ void paintMenu(float deltaTime) {
 		resetControls.paint(wdx + tileLength * 14, wdy + tileLength * 16.25);
 		break;
 	}
-	case 4: // SCORES
-		for (int i = 0; i < scoreEntries.size(); i++) {
-			scoreEntries[i]->nameT.paint(wdx + tileLength * 8, wdy + (int)(tileLength * (5 + 1.25 * (float)i)), LEFT);
-			scoreEntries[i]->scoreT.paint(screenWidth - wdx - tileLength, wdy + (int)(tileLength * (5 + 1.25 * (float)i)), RIGHT);
+	case 4: { // SCORES
+		char modeName[32];
+		if (HighScores::isCustomMode(scoreMode)) snprintf(modeName, sizeof(modeName), "< Custom %04X >", (unsigned int) (scoreMode & 0xFFFF));
+		else snprintf(modeName, sizeof(modeName), "< Level %i >", (int) scoreMode);
+		scoreModeT.change(modeName, (int) (tileLength * .6));
+		scoreModeT.paint(wdx + tileLength * 14, wdy + (int) (tileLength * 3.5));
+
+		const std::vector<scoreRecord> &top = highScores.top(scoreMode);
+		for (int i = 0; i < top.size(); i++) {
+			scoreNameT[i].change(top[i].name, (int) (tileLength * .6));
+			scoreValueT[i].change(std::to_string(top[i].score), (int) (tileLength * .6));
+			scoreNameT[i].paint(wdx + tileLength * 8, wdy + (int)(tileLength * (5 + 1.25 * (float)i)), LEFT);
+			scoreValueT[i].paint(screenWidth - wdx - tileLength, wdy + (int)(tileLength * (5 + 1.25 * (float)i)), RIGHT);
 		}
 		break;
+	}
 	case 5: // EXIT
 		break;
 	default
@@ -950,114 +1380,6 @@ void paintMenu(float deltaTime) {
 	}
 }
 
-fallState fall() {
-	if (!currentShape->fall(grid, true)) {
-		isLocking = true;
-		return PLACED;
-	}
-	return FELL;
-}
-
-void addShape() {
-	for (int x = 0; x < currentShape->data.size(); x++) {
-		for (int y = 0; y < currentShape->data.size(); y++) {
-			if (currentShape->data[y][x].exists) {
-				grid[currentShape->y + y][currentShape->x + x] = currentShape->data[y][x];
-			}
-		}
-	}
-
-	int yMin = 0, linesCleared = 0;
-	for (int y = height - 1; y >= yMin;) {
-		bool blank = false;
-
-		for (int x = 0; x < width; x++) {
-			if (!grid[y][x].exists) {
-				blank = true;
-				break;
-			}
-		}
-
-		if (!blank) {
-			linesCleared++;
-			lines++;
-
-			linesNumT.change(std::to_string(lines));
-
-			yMin++;
-
-			for (int yy = y; yy >= 1; yy--) {
-				for (int x = 0; x < width; x++) {
-					grid[yy][x] = grid[yy - 1][x];
-				}
-			}
-
-			for (int x = 0; x < width; x++) {
-				grid[0][x].exists = false;
-			}
-		} else {
-			y--;
-		}
-	}
-
-	if (linesCleared > 0) {
-		score += (int) (lineClearPoints[linesCleared - 1] * level * ((linesCleared == 4 && lastClearDifficult) ? lineClearPoints[4] : 1) + lineClearPoints[5] * lineClearCombos * level);
-
-		scoreNumT.change(std::to_string(score));
-
-		lastClearDifficult = linesCleared == 4;
-		lineClearCombos++;
-		level = startingLevel + lines / (isCustom ? custom[10].currentOption : 10);
-		levelNumT.change(std::to_string(level));
-		linesNumT.change(std::to_string(lines));
-		normalSpeed = (0.3F * (float) pow(level, 1.5F) + 0.7F) * (isCustom ? (float) pow(2, custom[4].currentOption) : 1.0F);
-		// printf("%f / %f = %f (%f/s)\n", (float) pow(2, custom[4].currentOption), (0.3F * (float) pow(level, 1.5F) + 0.7F), normalSpeed, 1.0F / normalSpeed);
-		lockDelay = (float) (sqrt(level) + 2.0F) / 6.0F;
-		fastSpeed = std::max(fastSpeed, normalSpeed);
-
-		if (lastClearDifficult) {
-			Mix_PlayChannel(-1, difficult, 0);
-		} else {
-			Mix_PlayChannel(-1, clear, 0);
-		}
-	} else {
-		lineClearCombos = 0;
-		Mix_PlayChannel(-1, placed, 0);
-	}
-
-	newShape();
-}
-
-void newShape() {
-	for (unsigned i = 0; i < shapeIndexes.size(); i++) {
-		if (shapeIndexes[i] == -1) continue;
-
-		if (currentShape != NULL) delete currentShape;
-		currentShape = new Shape;
-
-		currentShape->data = Shape::shapes[shapeIndexes[i]];
-		currentShapeIndex = shapeIndexes[i];
-		currentShape->x = (grid[0].size() - currentShape->data.size()) / 2;
-
-		shapeIndexes[i] = -1;
-
-		if (godDammitEthanWhyDidYouNameTheSoundGameOver()) return;
-
-		isFast = false;
-		canHold = true;
-
-		return;
-	}
-
-	shapeIndexes = nextShapeIndexes;
-
-	for (int i = 0; i < Shape::shapes.size(); i++) nextShapeIndexes[i] = i;
-
-	std::random_shuffle(nextShapeIndexes.begin(), nextShapeIndexes.end());
-
-	newShape();
-}
-
 void refreshText() {
 	title.change("POLYIS", tileLength * 3, {0, 255, 0});
 	mainSubs[0].text.change("Play");
@@ -1108,75 +1430,90 @@ void refreshText() {
 
 	resetControls.change("Reset", tileLength * .6);
 
-	for (int i = 0; i < scoreEntries.size(); i++) {
-		scoreEntries[i]->nameT.change(scoreEntries[i]->nameT.text, tileLength * .6);
-		scoreEntries[i]->scoreT.change(scoreEntries[i]->scoreT.text, tileLength * .6);
-	}
-
 	endOptions[0].change("Main Menu", tileLength * .6);
 	endOptions[1].change("Play Again", tileLength * .6);
 
 	scoreT.change("Score");
-	scoreNumT.change(std::to_string(score));
+	scoreNumT.change(std::to_string(game->score));
 	linesT.change("Lines");
-	linesNumT.change(std::to_string(lines));
+	linesNumT.change(std::to_string(game->lines));
 	levelT.change("Level");
-	levelNumT.change(std::to_string(level));
+	levelNumT.change(std::to_string(game->level));
 	nextT.change("Next");
 	holdT.change("Hold");
+	livesT.change("Lives: " + std::to_string(game->lives));
 }
 
 void beginGame(int lvl, bool customLevel) {
-	grid = gridArray(height, std::vector<Tile>(width));
-
-	currentShape = NULL;
-	currentShapeIndex = 0;
-
-	nextShapeIndexes = shapeIndexes = {};
-
-	for (unsigned i = 0; i < Shape::shapes.size(); i++) {
-		nextShapeIndexes.push_back(i);
+	gameSettings settings;
+
+	if (customLevel) {
+		settings.width = std::max(4, custom[1].currentOption);
+		settings.height = std::max(6, custom[2].currentOption);
+		settings.shape = (gridShape) custom[3].currentOption;
+		settings.gravityMultiplier = custom[4].currentOption;
+		settings.gravity = (gravityDirection) custom[5].currentOption;
+		settings.floodFill = custom[6].currentOption == 1;
+		settings.lives = custom[7].currentOption;
+		settings.lockDelayMultiplier = custom[9].currentOption;
+		settings.linesPerLevel = custom[10].currentOption;
 	}
 
-	std::random_shuffle(nextShapeIndexes.begin(), nextShapeIndexes.end());
-
-	newShape();
+	settings.startingLevel = lvl;
 
-	heldIndex = -1;
+	width = settings.width;
+	height = settings.height;
+	isCustom = customLevel;
 
-	score = lines = lineClearCombos = 0;
-	bool lastClearDifficult = false;
+	Uint64 seed = ((Uint64) rand() << 32) | rand();
+	tickTime = 0.0F;
 
-	fastFallTime = normalFallTime = lockTime = 0.0F;
-	isFast = isLocking = false;
-	canHold = true;
+	versusWon = false;
 
-	isCustom = customLevel;
+	if (netplayMode) { // The joining side gets the settings and seed from the host
+		bool connected = netplayAddress.empty() ? netplay.host(netplayPort, settings, seed) : netplay.join(netplayAddress.c_str(), netplayPort);
+		if (!connected) { // The boards were never begun (or are left over from the last game), so there's nothing to play
+			printf("Netplay: couldn't open a socket\n");
+			game = &soloGame;
+			returnToMenu();
+			return;
+		}
+		game = &netplay.current.games[netplay.player];
+	} else if (versusPlayers > 1) { // Garbage comes from the other boards, so a versus board can't be replayed on its own
+		versus.begin(versusPlayers, settings, seed);
+		bots.assign(versus.games.size(), Bot());
+		game = &versus.games[0];
+	} else {
+		game = &soloGame;
 
-	startingLevel = level = lvl;
+		if (!replayDirectory.empty()) {
+			replay.start(settings, seed);
+			game->recording = &replay;
+		}
 
-	levelNumT.change(std::to_string(level));
-	normalSpeed = (0.3F * (float) pow(level, 1.5F) + 0.7F) * (isCustom ? (float) pow(2, custom[4].currentOption) : 1);
-	lockDelay = ((float) (sqrt(level) + 2) / 6) * (isCustom ? (float) pow(2, custom[9].currentOption) : 1);
-	fastSpeed = std::max(30.0F, normalSpeed);
+		game->begin(settings, seed);
+	}
 
-	Mix_PlayMusic(korobeinki, -1);
+	updateCamera(-1);
+	clearMinimap();
 
-	scoreNumT.change(std::to_string(score));
-	linesNumT.change(std::to_string(lines));
-	levelNumT.change(std::to_string(startingLevel));
+	if (korobeinki != NULL) Mix_PlayMusic(korobeinki, -1); // NULL until loadAssets is done
 
 	state = PLAYING;
 }
 
 void pauseGame(bool pause) {
-	if (pause) Mix_PauseMusic(); else Mix_ResumeMusic();
+	if (korobeinki != NULL) {
+		if (pause) Mix_PauseMusic(); else Mix_ResumeMusic();
+	}
 
 	state = pause ? PAUSED : PLAYING;
 }
 
 void returnToMenu() {
-	if (Mix_PlayingMusic() != NULL) Mix_HaltMusic();
+	if (korobeinki != NULL && Mix_PlayingMusic()) Mix_HaltMusic();
+
+	saveReplay();
 
 	menuFocus = true;
 	playX = playY = 0;
@@ -1199,139 +1536,50 @@ void returnToMenu() {
 	state = MAIN_MENU;
 }
 
-void saveSettings() {
-	FILE *settingsFile;
-
-	if (fopen_s(&settingsFile, "settings.cfg", "w") != 0) return;
+/// Settings file key for a menu label, e.g. "Sound FX Volume" is sound_fx_volume
+std::string settingKey(std::string label) {
+	std::replace(label.begin(), label.end(), ' ', '_');
+	std::transform(label.begin(), label.end(), label.begin(), ::tolower);
+	return label;
+}
 
+/// Points the settings store at every option, custom game option and control. Labels have to be set first
+void addSettings() {
 	for (int n = 0; n < 4; n++) {
-		std::string text = options[n].text.text;
-		std::replace(text.begin(), text.end(), ' ', '_');
-		std::transform(text.begin(), text.end(), text.begin(), ::tolower);
-		fprintf(settingsFile, "%s=%i\n", text.c_str(), options[n].currentOption);
+		int min, max;
+		optionRange(options[n], min, max);
+		settingsStore.add(settingKey(options[n].text.text), &options[n].currentOption, min, max);
 	}
 
-	for (int n = 0; n < 9; n++) {
-		std::string text = controls[n].text.text;
-		std::replace(text.begin(), text.end(), ' ', '_');
-		std::transform(text.begin(), text.end(), text.begin(), ::tolower);
-		fprintf(settingsFile, "%s=%i\n", text.c_str(), controls[n].key);
+	for (int n = 0; n < 11; n++) {
+		int min, max;
+		optionRange(custom[n], min, max);
+		settingsStore.add("custom_" + settingKey(custom[n].text.text), &custom[n].currentOption, min, max);
 	}
 
-	fclose(settingsFile);
-}
-
-void loadSettings() {
-	FILE *settingsFile;
-
-	if (fopen_s(&settingsFile, "settings.cfg", "r") != 0) return;
-
-	std::string key = "", val = "";
-	bool keyFinding = true;
-	char c = 0;
-	int i = -1;
-	int t = 0;
-	while (c != EOF) {
-		c = fgetc(settingsFile);
-		if (c == '=') {
-			keyFinding = false;
-
-			for (int n = 0; n < 4; n++) {
-				std::string text = options[n].text.text;
-				std::replace(text.begin(), text.end(), ' ', '_');
-				std::transform(text.begin(), text.end(), text.begin(), tolower);
-				if (text == key) {
-					i = n;
-					t = 2;
-					break;
-				}
-			}
-			
-			if (t <= 0) {
-				for (int n = 0; n < 9; n++) {
-					std::string text = controls[n].text.text;
-					std::replace(text.begin(), text.end(), ' ', '_');
-					std::transform(text.begin(), text.end(), text.begin(), tolower);
-					if (text == key) {
-						i = n;
-						t = 3;
-						break;
-					}
-				}
-			}
-		} else if (c == '\n') {
-			keyFinding = true;
-
-			if (t == 2) options[i].currentOption = stoi(val);
-			else if (t == 3) controls[i].key = stoi(val);
-
-			key = "";
-			val = "";
-			t = 0;
-		} else if (keyFinding) {
-			key += c;
-		} else {
-			val += c;
-		}
+	for (int n = 0; n < 9; n++) {
+		settingsStore.add(settingKey(controls[n].text.text), &controls[n].key, 0, INT_MAX);
 	}
-
-	fclose(settingsFile);
-
-	Mix_VolumeMusic((128 * options[0].currentOption * options[1].currentOption) / 10000);
-	Mix_VolumeChunk(move, (128 * options[0].currentOption * options[2].currentOption) / 10000);
-	Mix_VolumeChunk(rotate, (128 * options[0].currentOption * options[2].currentOption) / 10000);
-	Mix_VolumeChunk(clear, (128 * options[0].currentOption * options[2].currentOption) / 10000);
-	Mix_VolumeChunk(difficult, (128 * options[0].currentOption * options[2].currentOption) / 10000);
-	Mix_VolumeChunk(placed, (128 * options[0].currentOption * options[2].currentOption) / 10000);
-	Mix_VolumeChunk(gameOver, (128 * options[0].currentOption * options[2].currentOption) / 10000);
 }
 
-void saveScores() {
-	FILE *scoresFile;
-
-	if (fopen_s(&scoresFile, "scores", "w") != 0) return;
+void saveSettings() {
+	settingsStore.save("settings.cfg");
+}
 
-	for (int i = 0; i < scoreEntries.size(); i++) {
-		fprintf(scoresFile, "%i %s\n", scoreEntries[i]->score, scoreEntries[i]->name.c_str());
-	}
+void loadSettings() {
+	settingsStore.load("settings.cfg");
 
-	fclose(scoresFile);
+	Sound::setVolume(options[0].currentOption, options[1].currentOption, options[2].currentOption);
 }
 
-void loadScores() {
-	scoreEntries = {};
-	FILE *scoresFile;
-
-	if (fopen_s(&scoresFile, "scores", "r") != 0) return;
-
-	std::string tempScore, name;
-	bool scoreFinding = true;
-	char c = 0;
-	while (c != EOF) {
-		c = fgetc(scoresFile);
-		if (c == ' ' && scoreFinding) {
-			scoreFinding = false;
-		} else if (c == '\n') {
-			scoreFinding = true;
-
-			
-			scoreEntry* newEntry = new scoreEntry;
-			newEntry->name = name;
-			newEntry->score = std::stoi(tempScore);
-			newEntry->nameT.change(name, tileLength * .6);
-			newEntry->scoreT.change(tempScore, tileLength * .6);
-			scoreEntries.push_back(newEntry);
-			
-			tempScore = "";
-			name = "";
-		} else if (scoreFinding) {
-			tempScore += c;
-		} else {
-			name += c;
-		}
-	}
+/// Moves the scores menu to the next (or previous) mode that has scores
+void changeScoreMode(int step) {
+	std::vector<uint64_t> modes = highScores.modes();
+	if (modes.empty()) return;
 
-	fclose(scoresFile);
+	int n = (int) (std::find(modes.begin(), modes.end(), scoreMode) - modes.begin());
+	if (n == modes.size()) n = step > 0 ? -1 : 0;
+	scoreMode = modes[(n + step + modes.size()) % modes.size()];
 }
 
 bool init() {
@@ -1350,7 +1598,7 @@ bool init() {
 
 	SDL_SetWindowMinimumSize(window, 450, 416);
 
-	renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+	renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_TARGETTEXTURE);
 	if (renderer == NULL) {
 		printf("Error: Failed to create renderer. SDL Error: %s\n", SDL_GetError());
 		return false;
@@ -1362,44 +1610,15 @@ bool init() {
 		return false;
 	}
 
-	if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 4, 2048) != 0) {
-		printf("Error: Failed to initiate Mixer subsystem. SDL_Mixer Error: %s\n", Mix_GetError());
-		return false;
-	}
-
-	korobeinki = Mix_LoadMUS("resources/korobeinki.wav");
-	if (korobeinki == NULL) {
-		printf("Failed to load sound \"Korobeinki\". SDL_Mixer Error: %s\n", Mix_GetError());
-	}
-
-	move = Mix_LoadWAV("resources/move.wav");
-	if (move == NULL) {
-		printf("Failed to load sound \"move\". SDL_Mixer Error: %s\n", Mix_GetError());
-	}
-
-	rotate = Mix_LoadWAV("resources/rotate.wav");
-	if (rotate == NULL) {
-		printf("Failed to load sound \"rotate\". SDL_Mixer Error: %s\n", Mix_GetError());
-	}
-
-	clear = Mix_LoadWAV("resources/clear.wav");
-	if (clear == NULL) {
-		printf("Failed to load sound \"clear\". SDL_Mixer Error: %s\n", Mix_GetError());
-	}
-
-	difficult = Mix_LoadWAV("resources/maxclear.wav");
-	if (difficult == NULL) {
-		printf("Failed to load sound \"difficult\". SDL_Mixer Error: %s\n", Mix_GetError());
-	}
-
-	placed = Mix_LoadWAV("resources/placed.wav");
-	if (placed == NULL) {
-		printf("Failed to load sound \"placed\". SDL_Mixer Error: %s\n", Mix_GetError());
+	if (resources.open("resources.pak")) {
+		Text::fontData = resources.find("arial.ttf", Text::fontDataSize);
 	}
 
-	gameOver = Mix_LoadWAV("resources/ended.wav");
-	if (gameOver == NULL) {
-		printf("Failed to load sound \"gameOver\". SDL_Mixer Error: %s\n", Mix_GetError());
+	loadingThread = SDL_CreateThread(loadAssets, "loadAssets", NULL);
+	if (loadingThread == NULL) {
+		printf("Error: Failed to create loading thread, loading on this one. SDL Error: %s\n", SDL_GetError());
+		loadAssets(NULL);
+		finishLoading();
 	}
 
 	if (TTF_Init() == -1) {
@@ -1410,12 +1629,7 @@ bool init() {
 	Text::defaultSize = tileLength;
 	Text::renderer = renderer;
 
-	SDL_Surface* icon = IMG_Load("resources/icon.png");
-	if (icon == NULL) {
-		printf("Error: Failed to instatiate icon. SDL_IMG Error: %s\n", IMG_GetError());
-	}
-
-	SDL_SetWindowIcon(window, icon);
+	Shape::init();
 
 	title.change("POLYIS", tileLength * 3, {0, 255, 0});
 	mainSubs[0].text.change("Play", tileLength * 2);
@@ -1483,7 +1697,7 @@ bool init() {
 	customPlay.change("Play", tileLength * .6);
 
 	initSettings(true);
-	loadScores();
+	highScores.load("scores.log", "stats.log", "scores");
 
 	resetControls.change("Reset", tileLength * .6);
 
@@ -1502,6 +1716,80 @@ bool init() {
 	return true;
 }
 
+/// Reads from the archive are straight from the mapped file, so this is safe on any thread once init has opened it
+SDL_RWops *openResource(const char *name) {
+	size_t size = 0;
+	const uint8_t *data = resources.find(name, size);
+	if (data != NULL) return SDL_RWFromConstMem(data, (int) size);
+
+	SDL_RWops *file = SDL_RWFromFile(("resources/" + std::string(name)).c_str(), "rb");
+	if (file == NULL) printf("Error: Failed to open resource \"%s\". SDL Error: %s\n", name, SDL_GetError());
+	return file;
+}
+
+/// Runs on loadingThread. Music is only opened here, SDL_mixer streams it from the file while it plays
+int loadAssets(void *data) {
+	Uint64 frequency = SDL_GetPerformanceFrequency(), counter = SDL_GetPerformanceCounter(), last;
+
+	Sound::open();
+	last = counter;
+	counter = SDL_GetPerformanceCounter();
+	audioOpenTime = (float) (counter - last) * 1000 / frequency;
+
+	Sound::load(SOUND_MOVE, openResource("move.wav"), "move.wav");
+	Sound::load(SOUND_ROTATE, openResource("rotate.wav"), "rotate.wav");
+	Sound::load(SOUND_CLEAR, openResource("clear.wav"), "clear.wav");
+	Sound::load(SOUND_DIFFICULT, openResource("maxclear.wav"), "maxclear.wav");
+	Sound::load(SOUND_PLACED, openResource("placed.wav"), "placed.wav");
+	Sound::load(SOUND_GAME_OVER, openResource("ended.wav"), "ended.wav");
+	last = counter;
+	counter = SDL_GetPerformanceCounter();
+	soundsTime = (float) (counter - last) * 1000 / frequency;
+
+	SDL_RWops *musicFile = openResource("korobeinki.wav");
+	loadedMusic = musicFile != NULL ? Mix_LoadMUS_RW(musicFile, 1) : NULL;
+	if (loadedMusic == NULL) {
+		printf("Failed to load sound \"Korobeinki\". SDL_Mixer Error: %s\n", Mix_GetError());
+	}
+	last = counter;
+	counter = SDL_GetPerformanceCounter();
+	musicTime = (float) (counter - last) * 1000 / frequency;
+
+	SDL_RWops *iconFile = openResource("icon.png");
+	loadedIcon = iconFile != NULL ? IMG_Load_RW(iconFile, 1) : NULL;
+	if (loadedIcon == NULL) {
+		printf("Error: Failed to instatiate icon. SDL_IMG Error: %s\n", IMG_GetError());
+	}
+	last = counter;
+	counter = SDL_GetPerformanceCounter();
+	iconTime = (float) (counter - last) * 1000 / frequency;
+
+	assetsLoaded = true;
+	return 0;
+}
+
+/// Hands what loadAssets loaded over to the main thread and prints the startup timings
+void finishLoading() {
+	if (loadingThread != NULL) SDL_WaitThread(loadingThread, NULL);
+	loadingThread = NULL;
+
+	korobeinki = loadedMusic;
+	Sound::enable();
+	if (korobeinki != NULL && (state == PLAYING || state == PAUSED)) {
+		Mix_PlayMusic(korobeinki, -1);
+		if (state == PAUSED) Mix_PauseMusic();
+	}
+
+	if (loadedIcon != NULL) {
+		SDL_SetWindowIcon(window, loadedIcon);
+		SDL_FreeSurface(loadedIcon);
+		loadedIcon = NULL;
+	}
+
+	float total = (float) (SDL_GetPerformanceCounter() - startCounter) * 1000 / SDL_GetPerformanceFrequency();
+	printf("Startup: assets loaded after %.1fms (audio device %.1fms, sounds %.1fms, music %.1fms, icon %.1fms)\n", total, audioOpenTime, soundsTime, musicTime, iconTime);
+}
+
 void initSettings(bool load) {
 	options[0].text.change("Master Volume", tileLength * .6);
 	options[1].text.change("Music Volume", tileLength * .6);
@@ -1547,6 +1835,7 @@ void initSettings(bool load) {
 	controls[7].key = SDLK_p;
 	controls[8].key = SDLK_F7;
 
+	addSettings();
 	if (load) loadSettings();
 	saveSettings();
 }
@@ -1563,62 +1852,86 @@ std::string randomStringGenerator(const int len) { // TEMP FUNCTION. TO BE DELET
 
 	return string;
 }
-bool scoreSorting(scoreEntry* left, scoreEntry* right) { return left->score > right->score; }
-bool godDammitEthanWhyDidYouNameTheSoundGameOver() { // TODO: Rename function to checkGameOver or something like that
-	for (int x = 0; x < currentShape->data.size(); x++) {
-		for (int y = 0; y < currentShape->data.size(); y++) {
-			if (currentShape->data[y][x].exists) {
-				if (grid[currentShape->y + y][currentShape->x + x].exists) {
-					state = ENDED;
-					selectedEndMenuIndex = 0;
-					Mix_HaltMusic();
-					Mix_PlayChannel(-1, gameOver, 0);
-
-					if (!isCustom) {
-						scoreEntry* newEntry = new scoreEntry;
-						newEntry->name = randomStringGenerator(5);
-						newEntry->score = score;
-						newEntry->nameT.change(newEntry->name, tileLength * .6);
-						newEntry->scoreT.change(std::to_string(score), tileLength * .6);
-						scoreEntries.push_back(newEntry);
-
-						std::sort(scoreEntries.begin(), scoreEntries.end(), scoreSorting);
-					}
-
-					return true;
-				}
-			}
-		}
+/// Plays sounds and updates text for whatever happened in the game since the last frame
+void handleGameEvents() {
+	unsigned int events = netplayMode ? netplay.takeEvents() : game->takeEvents();
+	if (events == 0) return;
+
+	if (events & SHAPE_MOVED) Sound::play(SOUND_MOVE);
+	if (events & SHAPE_ROTATED) Sound::play(SOUND_ROTATE);
+	if (events & DIFFICULT_CLEAR) Sound::play(SOUND_DIFFICULT);
+	else if (events & LINES_CLEARED) Sound::play(SOUND_CLEAR);
+	if (events & SHAPE_PLACED) Sound::play(SOUND_PLACED);
+
+	if (events & (SHAPE_PLACED | LINES_CLEARED | LIFE_LOST | GARBAGE_ADDED)) minimapDirty = true;
+
+	if (events & STATS_CHANGED) {
+		scoreNumT.change(std::to_string(game->score));
+		linesNumT.change(std::to_string(game->lines));
+		levelNumT.change(std::to_string(game->level));
+		livesT.change("Lives: " + std::to_string(game->lives));
 	}
 
-	return false;
+	if (events & GAME_OVER) endGame();
+}
+
+/// Keys go straight to the game, or to the next tick sent to the other player in netplay
+void playerInput(gameInput input) {
+	if (netplayMode) netplay.input(input);
+	else game->input(input);
+}
+
+/// Versus games aren't scored, the other players decide how long they last
+void endGame() {
+	state = ENDED;
+	selectedEndMenuIndex = 0;
+	if (korobeinki != NULL) Mix_HaltMusic();
+	Sound::play(SOUND_GAME_OVER);
+
+	if (versusPlayers > 1 || netplayMode) return;
+
+	saveReplay();
+
+	scoreMode = isCustom ? HighScores::customMode(game->settings) : HighScores::standardMode(game->settings.startingLevel);
+	highScores.add(scoreMode, randomStringGenerator(5), *game);
+}
+
+void saveReplay() {
+	if (game->recording == NULL) return;
+
+	replay.finish(*game);
+	game->recording = NULL;
+
+	char path[64];
+	snprintf(path, sizeof(path), "/%lld-%u.replay", (long long) time(0), game->score);
+	replay.save((replayDirectory + path).c_str());
 }
 
 void close() {
+	if (loadingThread != NULL) finishLoading();
+	highScores.close();
+	netplay.close();
+
+	saveReplay();
 	saveSettings();
-	saveScores();
 
 	Mix_FreeMusic(korobeinki);
 	korobeinki = NULL;
 
-	Mix_FreeChunk(move);
-	Mix_FreeChunk(rotate);
-	Mix_FreeChunk(clear);
-	Mix_FreeChunk(difficult);
-	Mix_FreeChunk(gameOver);
-	Mix_FreeChunk(placed);
-	move = NULL;
-	rotate = NULL;
-	clear = NULL;
-	difficult = NULL;
-	placed = NULL;
-	gameOver = NULL;
+	Sound::close();
+
+	clearPreviews();
+	clearMinimap();
 
 	SDL_DestroyWindow(window);
 	SDL_DestroyRenderer(renderer);
 	window = NULL;
 	renderer = NULL;
 
+	Text::closeFonts();
+	Text::fontData = NULL;
+	resources.close(); // After everything that reads from it (music, fonts)
+
 	Mix_Quit();
 	IMG_Quit();
 	TTF_Quit();
@@ -0,0 +1,322 @@
+#include "netplay.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdio.h>
+
+const uint32_t Netplay::magic;
+const unsigned int Netplay::maxRollback;
+const unsigned int Netplay::inputsPerPacket;
+const unsigned int Netplay::maxTickInputs;
+
+/// magic, type, tick count, 2 reserved bytes, first tick (the session for hello and start), ticks acknowledged, sender's tick, sender's lead.
+/// Inputs follow as each tick's number of inputs and then the inputs in order
+static const int headerSize = 24;
+static const int settingsSize = 8 + 10 * 4;
+static const int packetSize = headerSize + std::max(settingsSize, (int) (Netplay::inputsPerPacket * (1 + Netplay::maxTickInputs)));
+
+static void writeWord(uint8_t *out, uint32_t value) {
+	memcpy(out, &value, 4);
+}
+
+static uint32_t readWord(const uint8_t *in) {
+	uint32_t value;
+	memcpy(&value, in, 4);
+	return value;
+}
+
+/// Same ranges the custom game menu allows, so a stray or broken start packet can't make a board the game couldn't have made itself
+static bool validSettings(const int values[10]) {
+	static const int ranges[10][2] = {
+		{4, 255}, {6, 255}, // width, height
+		{RECTANGLE, ARROW}, {FALL_DOWN, FALL_RIGHT},
+		{-3, 4}, {-3, 4}, // gravity and lock delay multipliers
+		{0, 1}, {0, 15}, // flood fill, lives
+		{2, 255}, {1, 10} // lines per level, starting level
+	};
+
+	for (int n = 0; n < 10; n++) {
+		if (values[n] < ranges[n][0] || values[n] > ranges[n][1]) return false;
+	}
+	return true;
+}
+
+bool Netplay::host(int port, const gameSettings &newSettings, uint64_t newSeed) {
+	close();
+	if (!socket.open(port)) return false;
+
+	player = 0;
+	session = 0;
+	settings = newSettings;
+	seed = newSeed;
+	current.begin(2, settings, seed);
+
+	printf("Netplay: waiting for a player on port %d\n", port);
+	return true;
+}
+
+bool Netplay::join(const char *address, int port) {
+	close();
+	if (!socket.open(0) || !socket.setPeer(address, port)) return false;
+
+	player = 1;
+	current.begin(2, gameSettings(), 0); // Replaced when the host's settings arrive, begun now so the boards can be painted meanwhile
+	lastHello = std::chrono::steady_clock::time_point();
+	session = (uint32_t) std::chrono::steady_clock::now().time_since_epoch().count() | 1;
+
+	printf("Netplay: joining %s:%d\n", address, port);
+	return true;
+}
+
+void Netplay::close() {
+	socket.close();
+	started = false;
+}
+
+void Netplay::begin() {
+	current.begin(2, settings, seed);
+	confirmed = current;
+
+	currentTick = confirmedTick = reportedTick = 0;
+	remoteTick = remoteAcked = 0;
+	remoteLead = 0;
+	pendingInputs.clear();
+	events = 0;
+	mispredicted = false;
+
+	inputs[player].assign(inputDelay, 0); // Nothing is pressed in the first ticks, while the first key press is still delayed
+	inputs[1 - player].clear();
+
+	rollbacks = rolledBackTicks = maxRolledBackTicks = stalls = 0;
+	rollbackSeconds = 0.0;
+
+	started = true;
+	printf("Netplay: started as player %d\n", player + 1);
+}
+
+void Netplay::poll() {
+	uint8_t packet[packetSize];
+	int size;
+	while ((size = socket.receive(packet, sizeof(packet))) >= 0) receive(packet, size);
+
+	if (!started) {
+		auto now = std::chrono::steady_clock::now();
+		if (player == 1 && now - lastHello >= std::chrono::milliseconds(100)) { // Until the host answers
+			uint8_t hello[headerSize] = {};
+			writeWord(hello, magic);
+			hello[4] = HELLO;
+			writeWord(hello + 8, session);
+			socket.send(hello, headerSize);
+			lastHello = now;
+		}
+		return;
+	}
+
+	unsigned int known = (unsigned int) std::min(inputs[0].size(), inputs[1].size());
+	while (confirmedTick < known && confirmedTick < currentTick) {
+		simulate(confirmed, confirmedTick);
+		confirmedTick++;
+	}
+
+	if (mispredicted) {
+		auto start = std::chrono::steady_clock::now();
+
+		// Copying into the same boards reuses their memory, so this is a few memcpys per board
+		current = confirmed;
+		for (unsigned int tick = confirmedTick; tick < currentTick; tick++) simulate(current, tick);
+
+		rollbacks++;
+		rolledBackTicks += currentTick - confirmedTick;
+		maxRolledBackTicks = std::max(maxRolledBackTicks, currentTick - confirmedTick);
+		rollbackSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		mispredicted = false;
+	}
+
+	send();
+}
+
+void Netplay::input(gameInput input) {
+	pendingInputs.push_back((uint8_t) input);
+}
+
+bool Netplay::update() {
+	if (!started) return false;
+
+	// Too far ahead of the other player's inputs, or ahead of the other player by more than a tick
+	int lead = (int) currentTick - (int) remoteTick;
+	if (currentTick >= inputs[1 - player].size() + maxRollback || lead - remoteLead > 2) {
+		stalls++;
+		return false;
+	}
+
+	unsigned int taken = std::min(maxTickInputs, (unsigned int) pendingInputs.size());
+	uint32_t list = 0;
+	for (unsigned int n = 0; n < taken; n++) list |= (uint32_t) (pendingInputs[n] + 1) << (4 * n);
+	inputs[player].push_back(list);
+	pendingInputs.erase(pendingInputs.begin(), pendingInputs.begin() + taken);
+
+	simulate(current, currentTick);
+	currentTick++;
+
+	send();
+	return true;
+}
+
+unsigned int Netplay::takeEvents() {
+	unsigned int taken = events;
+	events = 0;
+	return taken;
+}
+
+bool Netplay::ended() const {
+	return started && confirmed.playing() <= 1;
+}
+
+int Netplay::winner() const {
+	return confirmed.winner();
+}
+
+/// FNV-1a over what decides how the game goes on: cells, shapes, scores and garbage
+uint64_t Netplay::checksum() const {
+	uint64_t hash = 14695981039346656037ULL;
+	auto add = [&hash](const void *data, size_t size) {
+		for (size_t n = 0; n < size; n++) {
+			hash ^= ((const uint8_t*) data)[n];
+			hash *= 1099511628211ULL;
+		}
+	};
+
+	add(&confirmedTick, sizeof(confirmedTick));
+	for (const Game &game : confirmed.games) {
+		add(game.grid.cells.data(), game.grid.cells.size());
+		int state[] = {game.currentShape.index, game.currentShape.rotation, game.currentShape.x, game.currentShape.y, game.heldIndex, (int) game.score, (int) game.lines, (int) game.incomingGarbage, (int) game.shapeCount, game.ended};
+		add(state, sizeof(state));
+	}
+
+	return hash;
+}
+
+void Netplay::receive(const uint8_t *data, int size) {
+	if (size < headerSize || readWord(data) != magic) return;
+
+	int type = data[4], count = data[5];
+	unsigned int first = readWord(data + 8), ack = readWord(data + 12);
+
+	if (type == HELLO && player == 0) {
+		if (!started) {
+			session = first;
+			begin();
+		}
+		if (first == session) sendStart(); // Again for every hello, in case the last start was lost
+	} else if (type == START && player == 1 && !started && first == session && size >= headerSize + settingsSize) {
+		const uint8_t *body = data + headerSize;
+		memcpy(&seed, body, 8);
+
+		int values[10];
+		memcpy(values, body + 8, sizeof(values));
+		if (!validSettings(values)) return;
+
+		settings.width = values[0];
+		settings.height = values[1];
+		settings.shape = (gridShape) values[2];
+		settings.gravity = (gravityDirection) values[3];
+		settings.gravityMultiplier = values[4];
+		settings.lockDelayMultiplier = values[5];
+		settings.floodFill = values[6] != 0;
+		settings.lives = values[7];
+		settings.linesPerLevel = values[8];
+		settings.startingLevel = values[9];
+
+		begin();
+	} else if (type == INPUTS && started) {
+		std::vector<uint32_t> &remote = inputs[1 - player];
+
+		int offset = headerSize;
+		for (int n = 0; n < count; n++) {
+			int inputCount = offset < size ? data[offset++] : -1;
+			if (inputCount < 0 || inputCount > (int) maxTickInputs || offset + inputCount > size) return; // Cut short or broken
+
+			uint32_t list = 0;
+			for (int i = 0; i < inputCount; i++) {
+				if (data[offset + i] > HOLD) return;
+				list |= (uint32_t) (data[offset + i] + 1) << (4 * i);
+			}
+			offset += inputCount;
+
+			unsigned int tick = first + n;
+			if (tick != remote.size()) continue; // Already known, or a gap a later packet fills
+
+			remote.push_back(list);
+			if (tick < currentTick && list != 0) mispredicted = true; // It was guessed to be nothing
+		}
+
+		remoteAcked = std::max(remoteAcked, std::min(ack, (unsigned int) inputs[player].size()));
+
+		unsigned int tick = readWord(data + 16);
+		if (tick >= remoteTick) {
+			remoteTick = tick;
+			remoteLead = (int) readWord(data + 20);
+		}
+	}
+}
+
+/// Sends every input the other player hasn't acknowledged yet (up to inputsPerPacket), along with what we've received from them
+void Netplay::send() {
+	std::vector<uint32_t> &local = inputs[player];
+	unsigned int count = std::min(inputsPerPacket, (unsigned int) local.size() - remoteAcked);
+
+	uint8_t packet[packetSize];
+	writeWord(packet, magic);
+	packet[4] = INPUTS;
+	packet[5] = (uint8_t) count;
+	packet[6] = packet[7] = 0;
+	writeWord(packet + 8, remoteAcked);
+	writeWord(packet + 12, (uint32_t) inputs[1 - player].size());
+	writeWord(packet + 16, currentTick);
+	writeWord(packet + 20, (uint32_t) ((int) currentTick - (int) remoteTick));
+
+	int size = headerSize;
+	for (unsigned int n = 0; n < count; n++) {
+		uint8_t &inputCount = packet[size++];
+		inputCount = 0;
+		for (uint32_t list = local[remoteAcked + n]; list != 0; list >>= 4) {
+			packet[size++] = (uint8_t) ((list & 15) - 1);
+			inputCount++;
+		}
+	}
+
+	socket.send(packet, size);
+}
+
+void Netplay::sendStart() {
+	uint8_t packet[headerSize + settingsSize] = {};
+	writeWord(packet, magic);
+	packet[4] = START;
+	writeWord(packet + 8, session);
+
+	int values[10] = {settings.width, settings.height, settings.shape, settings.gravity, settings.gravityMultiplier, settings.lockDelayMultiplier, settings.floodFill, settings.lives, settings.linesPerLevel, settings.startingLevel};
+	memcpy(packet + headerSize, &seed, 8);
+	memcpy(packet + headerSize + 8, values, sizeof(values));
+
+	socket.send(packet, sizeof(packet));
+}
+
+/// Applies both players' inputs for tick (nothing for ones not known yet) and advances the boards
+void Netplay::simulate(Versus &state, unsigned int tick) {
+	for (int n = 0; n < 2; n++) {
+		uint32_t list = tick < inputs[n].size() ? inputs[n][tick] : 0;
+		for (; list != 0; list >>= 4) state.games[n].input((gameInput) ((list & 15) - 1));
+	}
+
+	state.update();
+
+	for (int n = 0; n < 2; n++) {
+		unsigned int taken = state.games[n].takeEvents();
+
+		// Game over is left to ended(), which only looks at confirmed ticks
+		if (&state == &current && n == player && tick >= reportedTick) {
+			events |= taken & ~GAME_OVER;
+			reportedTick = tick + 1;
+		}
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "udpSocket.h"
+#include "versus.h"
+
+/// Two player versus over UDP with input delay and rollback. Both peers simulate both boards from the same seed and the same inputs.
+/// Local inputs are sent for inputDelay ticks ahead. Until the other player's inputs for a tick arrive they're guessed to be nothing,
+/// and when a guess turns out wrong the boards go back to the last tick both players' inputs were known for and are simulated forward again
+class Netplay {
+public:
+	static const uint32_t magic = 0x4E594C50; // "PLYN"
+	/// Furthest the simulation runs ahead of the other player's inputs, which also caps how many ticks one rollback simulates again
+	static const unsigned int maxRollback = 16;
+	/// Ticks of unacknowledged inputs sent again in every packet, so a lost packet is covered by the next one
+	static const unsigned int inputsPerPacket = 64;
+	/// Most inputs one tick holds, in the order they were pressed. Any more wait for the next tick
+	static const unsigned int maxTickInputs = 8;
+
+	UdpSocket socket;
+	/// Ticks between pressing a key and it taking effect. Rollbacks only have to cover latency beyond this
+	unsigned int inputDelay = 2;
+
+	/// Board this peer controls, 0 for the host
+	int player = 0;
+	bool started = false;
+
+	/// Boards simulated up to the current tick, with guesses for the other player's missing inputs. This is what gets painted
+	Versus current;
+
+	/// Rollbacks so far, ticks they simulated again in total and at most, and time spent in them
+	unsigned int rollbacks = 0, rolledBackTicks = 0, maxRolledBackTicks = 0, stalls = 0;
+	double rollbackSeconds = 0.0;
+
+	/// Waits on port for someone to join, then starts a game with these settings
+	bool host(int port, const gameSettings &settings, uint64_t seed);
+	/// Asks the host at address:port to start. The settings and seed come from the host
+	bool join(const char *address, int port);
+	void close();
+
+	/// Handles everything received since the last call and sends what the other player is missing. Call every frame, also while not ticking
+	void poll();
+	/// Local input for the next tick, applied after the ones before it
+	void input(gameInput input);
+	/// Advances by one tick. False when stalled waiting for the other player to catch up
+	bool update();
+
+	/// Events on the local board since the last call. Ticks simulated again after a rollback don't report theirs twice
+	unsigned int takeEvents();
+
+	unsigned int tick() const { return currentTick; }
+	unsigned int confirmedTicks() const { return confirmedTick; }
+	/// Own inputs the other player has received
+	unsigned int acknowledged() const { return remoteAcked; }
+	/// True once a board has topped out in a tick both players' inputs are known for, so both peers agree on it
+	bool ended() const;
+	/// Board left standing, or -1 for a draw
+	int winner() const;
+	/// Hash of the confirmed boards, the same on both peers unless they've gone out of sync
+	uint64_t checksum() const;
+
+private:
+	enum packetType {
+		HELLO,
+		START,
+		INPUTS
+	};
+
+	/// Boards up to confirmedTick, simulated with known inputs only. Rollbacks start from here
+	Versus confirmed;
+	unsigned int currentTick = 0, confirmedTick = 0;
+	/// Inputs by tick for each player, as far as they are known. Each tick's are packed 4 bits apiece as gameInput + 1, first in the lowest bits, ending at a 0
+	std::vector<uint32_t> inputs[2];
+	std::vector<uint8_t> pendingInputs;
+	unsigned int remoteAcked = 0;
+	bool mispredicted = false;
+	/// Other player's tick and how far they were ahead of us, from their latest packet. Whoever is ahead waits a tick now and then
+	unsigned int remoteTick = 0;
+	int remoteLead = 0;
+
+	gameSettings settings;
+	uint64_t seed = 0;
+	/// Picked by the joining side and echoed by the host, so a host still in an old game doesn't start a new one with stale settings
+	uint32_t session = 0;
+
+	unsigned int events = 0, reportedTick = 0;
+	std::chrono::steady_clock::time_point lastHello;
+
+	void begin();
+	void receive(const uint8_t *data, int size);
+	void send();
+	void sendStart();
+	void simulate(Versus &state, unsigned int tick);
+};
@@ -0,0 +1,132 @@
+#include "profiler.h"
+#include "text.h"
+
+#include <cstdlib>
+#include <new>
+
+const int Profiler::historyLength;
+bool Profiler::visible = false;
+int Profiler::drawCalls = 0;
+int Profiler::rasterizations = 0;
+std::atomic<long> Profiler::allocations(0);
+
+Uint64 Profiler::frameStart = 0;
+int Profiler::frame = 0;
+float Profiler::frameTimes[historyLength] = {};
+float Profiler::sectionTimes[SECTION_COUNT][historyLength] = {};
+int Profiler::frameDrawCalls[historyLength] = {};
+int Profiler::frameRasterizations[historyLength] = {};
+long Profiler::frameAllocations[historyLength] = {};
+Uint64 Profiler::sectionTicks[SECTION_COUNT] = {};
+
+#ifdef POLYIS_PROFILE
+/// Every heap allocation in the program goes through here so the overlay can show allocations per frame
+void *operator new(size_t size) {
+	Profiler::allocations++;
+
+	void *p = malloc(size ? size : 1);
+	if (p == NULL) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) noexcept {
+	free(p);
+}
+#endif
+
+/// Ends the last frame, moving its counters into the history
+void Profiler::newFrame() {
+#ifdef POLYIS_PROFILE
+	Uint64 now = SDL_GetPerformanceCounter();
+	float frequency = (float) SDL_GetPerformanceFrequency() / 1000.0F;
+	int i = frame % historyLength;
+
+	if (frameStart != 0) {
+		frameTimes[i] = (now - frameStart) / frequency;
+		for (int s = 0; s < SECTION_COUNT; s++) sectionTimes[s][i] = sectionTicks[s] / frequency;
+		frameDrawCalls[i] = drawCalls;
+		frameRasterizations[i] = rasterizations;
+		frameAllocations[i] = allocations.exchange(0);
+		frame++;
+	}
+
+	frameStart = now;
+	drawCalls = rasterizations = 0;
+	for (int s = 0; s < SECTION_COUNT; s++) sectionTicks[s] = 0;
+#endif
+}
+
+void Profiler::addTime(profileSection section, Uint64 ticks) {
+	sectionTicks[section] += ticks;
+}
+
+void Profiler::paint(SDL_Renderer *renderer, int x, int y, int tileLength) {
+#ifdef POLYIS_PROFILE
+	static Text lines[6];
+
+	if (!visible || frame == 0) return;
+
+	int frames = std::min(frame, historyLength);
+
+	if (frame % 15 == 1) { // Averages of the last half second, updated a few times a second so the text is readable and cheap
+		int count = std::min(frames, 30);
+		float frameTime = 0, worstTime = 0, times[SECTION_COUNT] = {};
+		long draws = 0, rasters = 0, allocs = 0;
+
+		for (int n = 1; n <= count; n++) {
+			int i = (frame - n) % historyLength;
+			frameTime += frameTimes[i];
+			worstTime = std::max(worstTime, frameTimes[i]);
+			for (int s = 0; s < SECTION_COUNT; s++) times[s] += sectionTimes[s][i];
+			draws += frameDrawCalls[i];
+			rasters += frameRasterizations[i];
+			allocs += frameAllocations[i];
+		}
+
+		char buffer[64];
+		int size = (int) (tileLength * 0.45);
+
+		snprintf(buffer, sizeof(buffer), "Frame %.2f ms (worst %.2f)", frameTime / count, worstTime);
+		lines[0].change(buffer, size);
+		snprintf(buffer, sizeof(buffer), "Simulation %.3f ms", times[SIMULATION] / count);
+		lines[1].change(buffer, size);
+		snprintf(buffer, sizeof(buffer), "Render %.3f ms", times[RENDER] / count);
+		lines[2].change(buffer, size);
+		snprintf(buffer, sizeof(buffer), "Draw calls %ld", draws / count);
+		lines[3].change(buffer, size);
+		snprintf(buffer, sizeof(buffer), "Text rasterized %.2f", (float) rasters / count);
+		lines[4].change(buffer, size);
+		snprintf(buffer, sizeof(buffer), "Allocations %.1f", (float) allocs / count);
+		lines[5].change(buffer, size);
+	}
+
+	int lineHeight = (int) (tileLength * 0.6);
+	int graphHeight = tileLength * 2;
+
+	SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 192);
+	SDL_Rect box = {x, y, historyLength * 2 + lineHeight, graphHeight + lineHeight * 7};
+	Profiler::fillRect(renderer, &box);
+
+	/// Frame time histogram, one bar per frame with a line at 60fps. Bars over the line are red
+	for (int n = 0; n < frames; n++) {
+		float time = frameTimes[(frame - frames + n) % historyLength];
+		int barHeight = std::min(graphHeight, (int) (time / 33.3F * graphHeight));
+
+		if (time > 16.7F) SDL_SetRenderDrawColor(renderer, 255, 64, 64, 255);
+		else SDL_SetRenderDrawColor(renderer, 64, 255, 64, 255);
+
+		SDL_Rect bar = {x + lineHeight / 2 + n * 2, y + lineHeight / 2 + graphHeight - barHeight, 2, barHeight};
+		Profiler::fillRect(renderer, &bar);
+	}
+
+	SDL_SetRenderDrawColor(renderer, 255, 255, 255, 128);
+	SDL_Rect target = {x + lineHeight / 2, y + lineHeight / 2 + graphHeight / 2, historyLength * 2, 1};
+	Profiler::fillRect(renderer, &target);
+	SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+	for (int i = 0; i < 6; i++) {
+		lines[i].paint(x + lineHeight / 2, y + graphHeight + lineHeight * (i + 1), LEFT);
+	}
+#endif
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <SDL.h>
+
+#include <atomic>
+
+#if !defined(NDEBUG) && !defined(POLYIS_NO_PROFILE)
+#define POLYIS_PROFILE
+#endif
+
+enum profileSection {
+	SIMULATION,
+	RENDER,
+	SECTION_COUNT
+};
+
+/// Frame statistics for the debug overlay. Timers and counters compile to nothing when POLYIS_PROFILE isn't defined (release builds)
+class Profiler {
+public:
+	static const int historyLength = 120;
+
+	static bool visible;
+	static int drawCalls, rasterizations;
+	static std::atomic<long> allocations;
+
+	static void newFrame();
+	static void addTime(profileSection section, Uint64 ticks);
+	static void paint(SDL_Renderer *renderer, int x, int y, int tileLength);
+
+	/// SDL draw calls that add to drawCalls
+	static int fillRect(SDL_Renderer *renderer, const SDL_Rect *rect);
+	static int fillRects(SDL_Renderer *renderer, const SDL_Rect *rects, int count);
+	static int copy(SDL_Renderer *renderer, SDL_Texture *texture, const SDL_Rect *source, const SDL_Rect *area);
+
+private:
+	static Uint64 frameStart;
+	static int frame;
+	static float frameTimes[historyLength];
+	static float sectionTimes[SECTION_COUNT][historyLength];
+	static int frameDrawCalls[historyLength], frameRasterizations[historyLength];
+	static long frameAllocations[historyLength];
+	static Uint64 sectionTicks[SECTION_COUNT];
+};
+
+class ScopedTimer {
+public:
+	ScopedTimer(profileSection section) : section(section), start(SDL_GetPerformanceCounter()) {}
+	~ScopedTimer() { Profiler::addTime(section, SDL_GetPerformanceCounter() - start); }
+
+private:
+	profileSection section;
+	Uint64 start;
+};
+
+#ifdef POLYIS_PROFILE
+#define PROFILE_SCOPE(section) ScopedTimer scopedTimer(section)
+#define PROFILE_COUNT(counter) Profiler::counter++
+#else
+#define PROFILE_SCOPE(section)
+#define PROFILE_COUNT(counter)
+#endif
+
+inline int Profiler::fillRect(SDL_Renderer *renderer, const SDL_Rect *rect) {
+	PROFILE_COUNT(drawCalls);
+	return SDL_RenderFillRect(renderer, rect);
+}
+
+inline int Profiler::fillRects(SDL_Renderer *renderer, const SDL_Rect *rects, int count) {
+	PROFILE_COUNT(drawCalls);
+	return SDL_RenderFillRects(renderer, rects, count);
+}
+
+inline int Profiler::copy(SDL_Renderer *renderer, SDL_Texture *texture, const SDL_Rect *source, const SDL_Rect *area) {
+	PROFILE_COUNT(drawCalls);
+	return SDL_RenderCopy(renderer, texture, source, area);
+}
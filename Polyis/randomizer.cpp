@@ -0,0 +1,72 @@
+#include "randomizer.h"
+
+const int Randomizer::largeSetBag;
+
+/// The bag is only allocated here, never while a game is running
+void Randomizer::reset(int newShapeCount, uint64_t seed, int bagSize) {
+	state = seed ? seed : 1;
+	shapeCount = newShapeCount;
+	bagSize = bagSize > 0 ? std::min(bagSize, shapeCount) : shapeCount;
+
+	bag.resize(bagSize);
+	for (int i = 0; i < bagSize; i++) bag[i] = i;
+	remaining = bagSize;
+
+	if (bagSize < shapeCount) {
+		int bits = 1;
+		while ((1U << bits) < (uint32_t) shapeCount) bits++;
+		cycleMask = (1U << bits) - 1;
+		cycleShift = (bits + 1) / 2;
+
+		newCycle();
+		refill();
+	}
+}
+
+int Randomizer::next() {
+	if (remaining == 0) { // Start a new bag
+		if (bag.size() == shapeCount) remaining = shapeCount; // Every shape is already back in it
+		else refill();
+	}
+
+	int i = random() % remaining;
+	std::swap(bag[i], bag[remaining - 1]);
+
+	return bag[--remaining];
+}
+
+/// xorshift64*, small enough to copy along with the rest of the game state
+uint32_t Randomizer::random() {
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return (uint32_t) ((state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+void Randomizer::newCycle() {
+	cyclePosition = 0;
+	cycleKey = random() & cycleMask;
+	cycleMultiplier = random() | 1;
+}
+
+/// Multiplying by an odd number, xoring in the high bits and adding a key each map the power of two onto itself, so together they do too.
+/// Values past the set are walked on until one lands inside it, which takes under two steps on average
+int Randomizer::permuted(uint32_t position) const {
+	uint32_t value = position;
+	do {
+		value = (value * cycleMultiplier) & cycleMask;
+		value ^= value >> cycleShift;
+		value = (value + cycleKey) & cycleMask;
+	} while (value >= (uint32_t) shapeCount);
+
+	return (int) value;
+}
+
+/// Fills the sub-bag with the next shapes of the ordering, starting a new ordering after every pass through the set
+void Randomizer::refill() {
+	for (int i = 0; i < bag.size(); i++) {
+		if (cyclePosition == shapeCount) newCycle();
+		bag[i] = permuted(cyclePosition++);
+	}
+	remaining = (int) bag.size();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+#include <algorithm>
+#include <vector>
+
+/// Bag randomizer that shuffles lazily: every draw picks one of the shapes left in the bag in O(1), so no up-front shuffle of the whole set is needed.
+/// A bag holds every shape once. With bagSize > 0 (and smaller than the set) it's a sub-bag instead: the next bagSize shapes of a random ordering of the whole set,
+/// so only bagSize entries are kept and refilled, and every shape still comes up once per pass through the set
+class Randomizer {
+public:
+	/// Sub-bag size for sets bigger than this, which keeps generated sets of thousands of shapes down to a preview sized bag
+	static const int largeSetBag = 32;
+
+	void reset(int shapeCount, uint64_t seed, int bagSize = 0);
+	int next();
+
+private:
+	uint64_t state = 1;
+	std::vector<int> bag;
+	int remaining = 0, shapeCount = 0;
+
+	/// Ordering of the whole set the sub-bags are cut from: a keyed permutation of the next power of two, skipping values past the set
+	uint32_t cyclePosition = 0, cycleKey = 0, cycleMultiplier = 1, cycleMask = 0;
+	int cycleShift = 1;
+
+	uint32_t random();
+	void newCycle();
+	int permuted(uint32_t position) const;
+	void refill();
+};
@@ -0,0 +1,106 @@
+#include "replay.h"
+
+const uint32_t Replay::magic;
+const uint32_t Replay::version;
+
+void Replay::start(const gameSettings &newSettings, uint64_t newSeed) {
+	settings = newSettings;
+	seed = newSeed;
+	inputs.clear();
+	score = lines = ticks = 0;
+}
+
+void Replay::finish(const Game &game) {
+	score = game.score;
+	lines = game.lines;
+	ticks = game.ticks;
+}
+
+/// Raw little endian fields, the header and then one 5 byte record per input
+bool Replay::save(const char *path) const {
+	FILE *file = fopen(path, "wb");
+	if (file == NULL) {
+		printf("Error: Failed to write replay \"%s\"\n", path);
+		return false;
+	}
+
+	int32_t header[] = {settings.width, settings.height, settings.shape, settings.gravity, settings.gravityMultiplier, settings.lockDelayMultiplier, settings.floodFill, settings.lives, settings.linesPerLevel, settings.startingLevel};
+	uint32_t result[] = {score, lines, ticks, (uint32_t) inputs.size()};
+
+	fwrite(&magic, sizeof(magic), 1, file);
+	fwrite(&version, sizeof(version), 1, file);
+	fwrite(header, sizeof(header), 1, file);
+	fwrite(&seed, sizeof(seed), 1, file);
+	fwrite(result, sizeof(result), 1, file);
+
+	for (int i = 0; i < inputs.size(); i++) {
+		fwrite(&inputs[i].tick, sizeof(inputs[i].tick), 1, file);
+		fwrite(&inputs[i].input, sizeof(inputs[i].input), 1, file);
+	}
+
+	bool written = ferror(file) == 0;
+	fclose(file);
+	return written;
+}
+
+bool Replay::load(const char *path) {
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		printf("Error: Failed to open replay \"%s\"\n", path);
+		return false;
+	}
+
+	uint32_t fileMagic = 0, fileVersion = 0;
+	int32_t header[10];
+	uint32_t result[4];
+
+	bool valid = fread(&fileMagic, sizeof(fileMagic), 1, file) == 1 && fileMagic == magic
+		&& fread(&fileVersion, sizeof(fileVersion), 1, file) == 1 && fileVersion == version
+		&& fread(header, sizeof(header), 1, file) == 1
+		&& fread(&seed, sizeof(seed), 1, file) == 1
+		&& fread(result, sizeof(result), 1, file) == 1;
+
+	if (valid) {
+		settings.width = header[0];
+		settings.height = header[1];
+		settings.shape = (gridShape) header[2];
+		settings.gravity = (gravityDirection) header[3];
+		settings.gravityMultiplier = header[4];
+		settings.lockDelayMultiplier = header[5];
+		settings.floodFill = header[6] != 0;
+		settings.lives = header[7];
+		settings.linesPerLevel = header[8];
+		settings.startingLevel = header[9];
+
+		score = result[0];
+		lines = result[1];
+		ticks = result[2];
+
+		inputs.resize(result[3]);
+		for (int i = 0; i < inputs.size() && valid; i++) {
+			valid = fread(&inputs[i].tick, sizeof(inputs[i].tick), 1, file) == 1 && fread(&inputs[i].input, sizeof(inputs[i].input), 1, file) == 1 && inputs[i].input <= HOLD;
+		}
+	}
+
+	fclose(file);
+
+	if (!valid) {
+		printf("Error: \"%s\" is not a valid replay\n", path);
+		inputs.clear();
+	}
+
+	return valid;
+}
+
+bool Replay::play(Game &game) const {
+	game.recording = NULL;
+	game.begin(settings, seed);
+
+	int next = 0;
+	while (!game.ended && game.ticks < ticks) {
+		while (next < inputs.size() && inputs[next].tick <= game.ticks) game.input((gameInput) inputs[next++].input);
+		game.update();
+	}
+
+	return game.score == score && game.lines == lines && game.ticks == ticks;
+}
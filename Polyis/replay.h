@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <stdio.h>
+#include <vector>
+
+#include "game.h"
+
+struct replayInput {
+	uint32_t tick;
+	uint8_t input;
+};
+
+/// Everything needed to play a game again: its settings, the randomizer seed and every input with the tick it happened on
+class Replay {
+public:
+	gameSettings settings;
+	uint64_t seed = 0;
+	std::vector<replayInput> inputs;
+
+	/// How the game ended when it was recorded, checked when it is played back
+	unsigned int score = 0, lines = 0, ticks = 0;
+
+	void start(const gameSettings &newSettings, uint64_t newSeed);
+	void finish(const Game &game);
+
+	bool save(const char *path) const;
+	bool load(const char *path);
+
+	/// Plays the whole replay on game. Returns true if it ended the same way as when it was recorded
+	bool play(Game &game) const;
+
+private:
+	static const uint32_t magic = 0x52594C50; // "PLYR"
+	static const uint32_t version = 1;
+};
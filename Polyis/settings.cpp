@@ -0,0 +1,115 @@
+#include "settings.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
+#include <stdio.h>
+
+void Settings::add(const std::string &key, int *value, int min, int max) {
+	auto found = index.find(key);
+	if (found == index.end()) {
+		found = index.emplace(key, (int) slots.size()).first;
+		slots.push_back({key, NULL, 0, 0, 0, false});
+	}
+
+	slot &s = slots[found->second];
+	s.value = value;
+	s.min = min;
+	s.max = max;
+}
+
+bool Settings::load(const char *path) {
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) return false;
+
+	std::string contents;
+	if (fseek(file, 0, SEEK_END) == 0) {
+		long size = ftell(file);
+		if (size > 0) {
+			contents.resize(size);
+			rewind(file);
+			contents.resize(fread(&contents[0], 1, size, file));
+		}
+	}
+	fclose(file);
+
+	clean = true;
+	for (int n = 0; n < slots.size(); n++) slots[n].inFile = false;
+
+	size_t start = 0;
+	while (start < contents.size()) {
+		size_t end = contents.find('\n', start);
+		if (end == std::string::npos) end = contents.size();
+
+		size_t lineEnd = end;
+		if (lineEnd > start && contents[lineEnd - 1] == '\r') lineEnd--;
+		size_t equals = contents.find('=', start);
+
+		if (lineEnd > start) {
+			auto found = equals < lineEnd ? index.find(contents.substr(start, equals - start)) : index.end();
+
+			if (found == index.end()) {
+				clean = false;
+			} else {
+				slot &s = slots[found->second];
+				std::string text = contents.substr(equals + 1, lineEnd - equals - 1);
+				char *parsedEnd;
+				errno = 0;
+				long value = strtol(text.c_str(), &parsedEnd, 10);
+
+				if (s.inFile) clean = false; // The last one counts, the duplicate goes on the next save
+
+				if (text.empty() || *parsedEnd != 0 || errno != 0 || value < s.min || value > s.max) {
+					printf("Ignoring setting \"%s\": \"%s\" is not a value from %i to %i\n", s.key.c_str(), text.c_str(), s.min, s.max);
+					clean = false;
+				} else {
+					*s.value = s.stored = (int) value;
+					s.inFile = true;
+				}
+			}
+		}
+
+		start = end + 1;
+	}
+
+	return true;
+}
+
+bool Settings::save(const char *path) {
+	bool changed = !clean;
+	for (int n = 0; n < slots.size() && !changed; n++) {
+		changed = !slots[n].inFile || *slots[n].value != slots[n].stored;
+	}
+	if (!changed) return true;
+
+	std::string contents;
+	for (int n = 0; n < slots.size(); n++) {
+		contents += slots[n].key + "=" + std::to_string(*slots[n].value) + "\n";
+	}
+
+	// A crash while writing leaves the old file untouched rather than half written
+	std::string temporary = std::string(path) + ".tmp";
+	FILE *file = fopen(temporary.c_str(), "wb");
+	if (file == NULL) {
+		printf("Error: Failed to write settings \"%s\"\n", temporary.c_str());
+		return false;
+	}
+
+	bool written = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+	written = fclose(file) == 0 && written;
+
+	std::error_code error;
+	if (written) std::filesystem::rename(temporary, path, error);
+	if (!written || error) {
+		printf("Error: Failed to replace settings \"%s\"\n", path);
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+
+	for (int n = 0; n < slots.size(); n++) {
+		slots[n].stored = *slots[n].value;
+		slots[n].inFile = true;
+	}
+	clean = true;
+	return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Integer settings kept in a key=value file. Every key is registered up front with the variable it lives in and the range it may take
+class Settings {
+public:
+	/// Adding a key again points it at the new variable and range
+	void add(const std::string &key, int *value, int min, int max);
+
+	/// Reads the whole file at once. Unknown keys, malformed lines and values out of range are skipped, leaving the variable as it was
+	bool load(const char *path);
+	/// Writes a temporary file and renames it over path, but only if the file would change
+	bool save(const char *path);
+
+private:
+	struct slot {
+		std::string key;
+		int *value;
+		int min, max;
+		int stored; // What the file has for this key, if inFile
+		bool inFile;
+	};
+
+	std::vector<slot> slots; // Saved in the order they were added
+	std::unordered_map<std::string, int> index;
+	/// The file has nothing in it besides the slots
+	bool clean = false;
+};
@@ -1,87 +1,103 @@
-#include "Shape.h"
+#include "shape.h"
 
 const std::vector<gridArray> Shape::shapes = { // Temp hardcoded vector of shapes before making the import system
-	{{Tile(000, 255, 255, false), Tile(000, 255, 255, false), Tile(000, 255, 255, false), Tile(000, 255, 255, false)},
-	{Tile(000, 255, 255, true), Tile(000, 255, 255, true), Tile(000, 255, 255, true), Tile(000, 255, 255, true)},
-	{Tile(000, 255, 255, false), Tile(000, 255, 255, false), Tile(000, 255, 255, false), Tile(000, 255, 255, false)},
-	{Tile(000, 255, 255, false), Tile(000, 255, 255, false), Tile(000, 255, 255, false), Tile(000, 255, 255, false)}
+	{{0, 0, 0, 0},
+	{1, 1, 1, 1},
+	{0, 0, 0, 0},
+	{0, 0, 0, 0}
 	},
-	{{Tile(000, 000, 255, true), Tile(000, 000, 255, false), Tile(000, 000, 255, false)},
-	{Tile(000, 000, 255, true), Tile(000, 000, 255, true), Tile(000, 000, 255, true)},
-	{Tile(000, 000, 255, false), Tile(000, 000, 255, false), Tile(000, 000, 255, false)}
+	{{2, 0, 0},
+	{2, 2, 2},
+	{0, 0, 0}
 	},
-	{{Tile(255, 128, 000, false), Tile(255, 128, 000, false), Tile(255, 128, 000, true), },
-	{Tile(255, 128, 000, true), Tile(255, 128, 000, true), Tile(255, 128, 000, true)},
-	{Tile(255, 128, 000, false), Tile(255, 128, 000, false), Tile(255, 128, 000, false)}
+	{{0, 0, 3},
+	{3, 3, 3},
+	{0, 0, 0}
 	},
-	{{Tile(255, 255, 000, true), Tile(255, 255, 000, true)},
-	{Tile(255, 255, 000, true), Tile(255, 255, 000, true)}
+	{{4, 4},
+	{4, 4}
 	},
-	{{Tile(128, 255, 000, false), Tile(128, 255, 000, true), Tile(128, 255, 000, true)},
-	{Tile(128, 255, 000, true), Tile(128, 255, 000, true), Tile(128, 255, 000, false)},
-	{Tile(128, 255, 000, false), Tile(128, 255, 000, false), Tile(128, 255, 000, false)}
+	{{0, 5, 5},
+	{5, 5, 0},
+	{0, 0, 0}
 	},
-	{{Tile(128, 000, 128, false), Tile(128, 000, 128, true), Tile(128, 000, 128, false)},
-	{Tile(128, 000, 128, true), Tile(128, 000, 128, true), Tile(128, 000, 128, true)},
-	{Tile(128, 000, 128, false), Tile(128, 000, 128, false), Tile(128, 000, 128, false)}
+	{{0, 6, 0},
+	{6, 6, 6},
+	{0, 0, 0}
 	},
-	{{Tile(255, 000, 000, true), Tile(255, 000, 000, true), Tile(255, 000, 000, false)},
-	{Tile(255, 000, 000, false), Tile(255, 000, 000, true), Tile(255, 000, 000, true)},
-	{Tile(255, 000, 000, false), Tile(255, 000, 000, false), Tile(255, 000, 000, false)}
+	{{7, 7, 0},
+	{0, 7, 7},
+	{0, 0, 0}
 	}
 };
 
+const std::vector<Color> Shape::palette = {
+	{000, 000, 000},
+	{000, 255, 255},
+	{000, 000, 255},
+	{255, 128, 000},
+	{255, 255, 000},
+	{128, 255, 000},
+	{128, 000, 128},
+	{255, 000, 000},
+	{128, 128, 128}
+};
+
 int Shape::tiles = 4;
 
-bool Shape::rotate(gridArray grid, bool clockwise) {
-	bool success = true;
-	gridArray rotData;
+std::vector<std::array<gridArray, 4>> Shape::rotations = {};
+std::vector<std::array<std::vector<cellOffset>, 4>> Shape::offsets = {};
+bool Shape::standardShapes = false;
+std::vector<kickDist> Shape::kicks = {};
 
-	for (int y = 0; y < data.size(); y++) {
-		rotData.push_back({});
-		for (int x = 0; x < data[y].size(); x++) {
-			rotData[y].push_back(Tile());
-		}
-	}
+void Shape::init() {
+	rotations.clear();
+	offsets.clear();
 
-	/* x is x pos of data (grid)
-	* y is y pos of data (grid)
-	* xx is x pos of tile in raw data (data)
-	* yy is y pos of tile in raw data (data)
-	* ((n - *if CW) yy + x) is the x pos of tile (grid)
-	* ((n - *if CCW) xx + y) is the y pos of tile (grid)
+	/* x is x pos of the rotated data
+	* y is y pos of the rotated data
+	* (n - 1 - y) is the x pos of the same tile before a clockwise rotation
+	* x is the y pos of the same tile before a clockwise rotation
 	*/
-	for (int xx = 0; xx <= data.size() - 1; xx++) {
-		for (int yy = 0; yy <= data.size() - 1; yy++) {
-			int fY, fX;
-
-			if (clockwise) {
-				fY = xx;
-				fX = data.size() - 1 - yy;
-			} else {
-				fY = data.size() - 1 - xx;
-				fX = yy;
+	for (int s = 0; s < shapes.size(); s++) {
+		std::array<gridArray, 4> shapeRotations;
+		shapeRotations[0] = shapes[s];
+
+		for (int r = 1; r < 4; r++) {
+			const gridArray &prev = shapeRotations[r - 1];
+			int n = prev.size();
+
+			shapeRotations[r] = prev;
+			for (int y = 0; y < n; y++) {
+				for (int x = 0; x < n; x++) {
+					shapeRotations[r][y][x] = prev[n - 1 - x][y];
+				}
 			}
+		}
 
-			if (data[yy][xx].exists) {
-				rotData[fY][fX] = data[yy][xx]; // TODO: Include left/right and up/down in formula (waiting for multi tile shapes first so I can debug)
+		rotations.push_back(shapeRotations);
 
-				if (fX + x < 0 || fX + x >= grid[0].size() || fY + y < 0 || fY + y >= grid.size() || grid[fY + y][fX + x].exists) {
-					success = false;
+		std::array<std::vector<cellOffset>, 4> shapeOffsets;
+		for (int r = 0; r < 4; r++) {
+			const gridArray &data = shapeRotations[r];
+			for (int y = 0; y < data.size(); y++) {
+				for (int x = 0; x < data.size(); x++) {
+					if (data[y][x]) shapeOffsets[r].push_back({(int8_t) x, (int8_t) y});
 				}
 			}
 		}
-	}
 
-	if (!success) {
-		if (!wallKick(grid, rotData)) return false;
+		offsets.push_back(shapeOffsets);
 	}
 
-	data = rotData;
-	return true;
-}
+	/// The compile time tetromino kernels are only used while the shape set is exactly the one they were built for
+	standardShapes = tiles == 4 && offsets.size() == 7;
+	for (int s = 0; s < offsets.size() && standardShapes; s++) {
+		for (int r = 0; r < 4 && standardShapes; r++) {
+			standardShapes = offsets[s][r].size() == 4 && memcmp(offsets[s][r].data(), tetrominoes.cells[s][r], sizeof(tetrominoes.cells[s][r])) == 0;
+		}
+	}
 
-bool Shape::wallKick(gridArray grid, gridArray rotData) {
 	std::set<kickDist> sset = {};//int shift[12][2] = {{0, 1}, {-1, 0}, {1, 0}, {0, -1}, {-1, 1}, {1, 1}, {-1, 1}, {-1, -1}, {0, 2}, {-2, 0}, {2, 0}, {0, -2}};
 
 	for (int a = 1; a < tiles; a++) {
@@ -90,115 +106,64 @@ bool Shape::wallKick(gridArray grid, gridArray rotData) {
 		}
 	}
 
-	std::vector<kickDist> shift(sset.begin(), sset.end());
+	kicks.assign(sset.begin(), sset.end());
+}
+
+bool Shape::fits(const Board &grid, int newRotation, int newX, int newY) const {
+	if (grid.standard && standardShapes) return ::fits<10, 22, 4>(grid.cells.data(), 10, 22, tetrominoes.cells[index][newRotation], 4, newX, newY);
+
+	const std::vector<cellOffset> &cells = offsets[index][newRotation];
+	return ::fits(grid.cells.data(), grid.width, grid.height, cells.data(), cells.size(), newX, newY);
+}
+
+bool Shape::rotate(const Board &grid, bool clockwise) {
+	int newRotation = (rotation + (clockwise ? 1 : 3)) % 4;
+
+	if (!fits(grid, newRotation, x, y) && !wallKick(grid, newRotation)) return false;
+
+	rotation = newRotation;
+	return true;
+}
+
+bool Shape::wallKick(const Board &grid, int newRotation) {
+	const std::vector<kickDist> &shift = kicks;
 
-	// for (int n = 1; n <= 2; n++) { // Can shift up to 2 tiles
 	for (int s = 0; s < shift.size(); s++) {
-		for (int n = 0; n < 8; n++) {
-			int newX = 0;// x + shift[s][0];
-			int newY = 0;// y + shift[s][1];
-
-			switch (n) {
-			case 0:
-				newX = x - shift[s].x;
-				newY = y + shift[s].y;
-				break;
-			case 1:
-				newX = x + shift[s].x;
-				newY = y + shift[s].y;
-				break;
-			case 2:
-				newX = x - shift[s].y;
-				newY = y + shift[s].x;
-				break;
-			case 3:
-				newX = x + shift[s].y;
-				newY = y + shift[s].x;
-				break;
-			case 4:
-				newX = x - shift[s].y;
-				newY = y - shift[s].x;
-				break;
-			case 5:
-				newX = x + shift[s].y;
-				newY = y - shift[s].x;
-				break;
-			case 6:
-				newX = x - shift[s].x;
-				newY = y - shift[s].y;
-				break;
-			case 7:
-				newX = x + shift[s].x;
-				newY = y - shift[s].y;
-				break;
-			}
+		/// Each distance is tried in all eight directions, the same order as always
+		int dx[8] = {-(int) shift[s].x, (int) shift[s].x, -(int) shift[s].y, (int) shift[s].y, -(int) shift[s].y, (int) shift[s].y, -(int) shift[s].x, (int) shift[s].x};
+		int dy[8] = {(int) shift[s].y, (int) shift[s].y, (int) shift[s].x, (int) shift[s].x, -(int) shift[s].x, -(int) shift[s].x, -(int) shift[s].y, -(int) shift[s].y};
 
-			bool b = false;
-
-			for (int yy = 0; yy < data.size(); yy++) {
-				for (int xx = 0; xx < data.size(); xx++) {
-					if (!rotData[yy][xx].exists) continue;
-					if (xx + newX < 0 || xx + newX >= grid[0].size() || yy + newY < 0 || yy + newY >= grid.size()) {
-						b = true;
-						break;
-					} else if (grid[yy + newY][xx + newX].exists) {
-						b = true;
-						break;
-					}
-				}
-				if (b) break;
-			}
-			if (b) continue;
+		for (int n = 0; n < 8; n++) {
+			if (!fits(grid, newRotation, x + dx[n], y + dy[n])) continue;
 
-			x = newX;
-			y = newY;
-			// printf("%i, %i\n", shift[s][0], shift[s][1]);
+			x += dx[n];
+			y += dy[n];
 			return true;
 		}
 	}
-	// }
 
 	return false;
 }
 
-bool Shape::move(gridArray grid, bool right) {
+bool Shape::move(const Board &grid, bool right) {
 	int newX = x + (right ? 1 : -1);
-
-	for (int yy = 0; yy < data.size(); yy++) {
-		for (int xx = 0; xx < data.size(); xx++) {
-			if (data[yy][xx].exists) {
-				if (xx + newX < 0 || xx + newX >= grid[0].size()) {
-					return false;
-				}
-
-				if (grid[yy + y][xx + newX].exists) {
-					return false;
-				}
-			}
-		}
-	}
+	if (!fits(grid, rotation, newX, y)) return false;
 
 	x = newX;
 	return true;
 }
 
-bool Shape::fall(gridArray grid, bool set) {
-	int newY = y + 1;
+bool Shape::fall(const Board &grid, bool set) {
+	if (!fits(grid, rotation, x, y + 1)) return false;
 
-	for (int xx = 0; xx < data.size(); xx++) {
-		for (int yy = 0; yy < data.size(); yy++) {
-			if (data[yy][xx].exists) {
-				if (yy + newY >= grid.size()) {
-					return false;
-				}
+	if (set) y++;
+	return true;
+}
 
-				if (grid[yy + newY][xx + x].exists) {
-					return false;
-				}
-			}
-		}
-	}
+/// Row the shape would come to rest on if dropped straight down from its current position
+int Shape::landingY(const Board &grid) const {
+	if (grid.standard && standardShapes) return ::landingY<10, 22, 4>(grid.cells.data(), 10, 22, tetrominoes.cells[index][rotation], 4, x, y);
 
-	if (set) y = newY;
-	return true;
-}
\ No newline at end of file
+	const std::vector<cellOffset> &cells = offsets[index][rotation];
+	return ::landingY(grid.cells.data(), grid.width, grid.height, cells.data(), cells.size(), x, y);
+}
@@ -1,14 +1,17 @@
-#include <SDL.h>
+#pragma once
+
+#include <cstdint>
 
 #include <algorithm>
+#include <array>
 #include <set>
 #include <vector>
 
-struct Tile {
-	Tile(Uint8 newR = 0, Uint8 newG = 0, Uint8 newB = 0, bool doesExist = false) : r(newR), g(newG), b(newB), exists(doesExist) {}
+#include "board.h"
+#include "kernels.h"
 
-	bool exists;
-	Uint8 r, g, b;
+struct Color {
+	uint8_t r, g, b;
 };
 
 /// For easy sorting
@@ -22,19 +25,38 @@ public:
 	}
 };
 
-typedef std::vector<std::vector<Tile>> gridArray;
+/// Shape data in the same format as Board cells (0 for empty, otherwise a palette index)
+typedef std::vector<std::vector<uint8_t>> gridArray;
 
 class Shape {
 public:
 	static const std::vector<gridArray> shapes;
+	/// Colors indexed by the values stored in shapes and in Board cells. Entry 0 is never drawn
+	static const std::vector<Color> palette;
+	/// Every orientation of every shape, indexed by [shape][rotation] (built once by init)
+	static std::vector<std::array<gridArray, 4>> rotations;
+	/// Tiles of every orientation as offsets, indexed like rotations (built once by init)
+	static std::vector<std::array<std::vector<cellOffset>, 4>> offsets;
+	/// True when the shapes are the seven tetrominoes, so standard boards can use the compile time kernels
+	static bool standardShapes;
+	/// Wall kick offsets sorted by distance (built once by init)
+	static std::vector<kickDist> kicks;
 
 	static int tiles;
 
-	gridArray data;
+	static void init();
+
+	Shape(int index = 0) : index(index) {}
+
+	int index, rotation = 0;
 	int y = 0, x = 0;
 
-	bool rotate(gridArray grid, bool clockwise);
-	bool wallKick(gridArray grid, gridArray rotData);
-	bool move(gridArray grid, bool right);
-	bool fall(gridArray grid, bool set);
+	const gridArray &data() const { return rotations[index][rotation]; }
+
+	bool fits(const Board &grid, int newRotation, int newX, int newY) const;
+	bool rotate(const Board &grid, bool clockwise);
+	bool wallKick(const Board &grid, int newRotation);
+	bool move(const Board &grid, bool right);
+	bool fall(const Board &grid, bool set);
+	int landingY(const Board &grid) const;
 };
\ No newline at end of file
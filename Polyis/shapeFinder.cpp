@@ -1,32 +1,22 @@
 #include "shapeFinder.h"
 
+const int ShapeFinder::maxTiles;
 int ShapeFinder::n = 0;
-const int ShapeFinder::counts[10] = {1, 1, 2, 7, 18, 60, 196, 704, 2500, 9189};
+const int ShapeFinder::counts[maxTiles] = {1, 1, 2, 7, 18, 60, 196, 704, 2500, 9189, 33896, 126759};
+bool ShapeFinder::verbose = false;
 std::vector<std::vector<bool>> ShapeFinder::blank = {};
 
 
 void ShapeFinder::start(int newN) {
 	int startTime = std::clock();
 
-	std::vector<std::vector<std::vector<bool>>> unique = {};
-	std::vector<std::vector<std::vector<bool>>> allRots = {};
-	n = std::min(10, std::max(1, newN));
-
-	printf("Shape Finder Started with %i tiles\n", n);
-
-	for (int x = 0; x < n; x++) {
-		blank.push_back({});
-		for (int y = 0; y < n; y++) {
-			blank[x].push_back(false);
-		}
-	}
-
-	std::vector<std::vector<bool>> grid = blank;
-	grid[floor((float)n / 2 - 0.5)][floor((float)n / 2 - 0.5)] = true;
+	printf("Shape Finder Started with %i tiles\n", std::min(maxTiles, std::max(1, newN)));
 
-	createShapes(grid, &unique, &allRots);
+	verbose = true;
+	std::vector<std::vector<std::vector<bool>>> unique = find(newN);
+	verbose = false;
 
-	printf("n = %i\n", unique.size());
+	printf("n = %i\n", (int) unique.size());
 
 	for (int i = 0; i < unique.size(); i++) {
 
@@ -40,8 +30,24 @@ void ShapeFinder::start(int newN) {
 
 	}
 
-	printf("n = %i\n", unique.size());
-	printf("%ims passed\n", std::clock() - startTime);
+	printf("n = %i\n", (int) unique.size());
+	printf("%ims passed\n", (int) (std::clock() - startTime));
+}
+
+std::vector<std::vector<std::vector<bool>>> ShapeFinder::find(int newN) {
+	std::vector<std::vector<std::vector<bool>>> unique = {};
+	std::vector<std::vector<std::vector<bool>>> allRots = {};
+	n = std::min(maxTiles, std::max(1, newN));
+
+	blank.assign(n, std::vector<bool>(n, false));
+
+	std::vector<std::vector<bool>> grid = blank;
+	grid[floor((float)n / 2 - 0.5)][floor((float)n / 2 - 0.5)] = true;
+
+	if (n == 1) unique.push_back(grid); // Nothing to grow, the single tile is the only shape
+	else createShapes(grid, &unique, &allRots);
+
+	return unique;
 }
 
 void ShapeFinder::createShapes(std::vector<std::vector<bool>> grid, std::vector<std::vector<std::vector<bool>>>* unique, std::vector<std::vector<std::vector<bool>>>* allRots) {
@@ -127,7 +133,7 @@ void ShapeFinder::createShapes(std::vector<std::vector<bool>> grid, std::vector<
 			unique->push_back(newGrid);
 			allRots->push_back(newGrid);
 
-			printf("Unique Shapes Found: %i\n", unique->size());
+			if (verbose) printf("Unique Shapes Found: %i\n", (int) unique->size());
 
 			for (int ii = 0; ii < 3; ii++)
 				allRots->push_back(rotate(newGrid, ii));
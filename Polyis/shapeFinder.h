@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cmath>
 #include <ctime>
 #include <stdio.h>
 #include <set>
@@ -6,11 +7,16 @@
 
 class ShapeFinder {
 public:
+	static const int maxTiles = 12;
+
 	static void start(int newN);
+	/// Every one-sided shape with n tiles, without printing anything
+	static std::vector<std::vector<std::vector<bool>>> find(int newN);
 
 private:
 	static int n;
-	static const int counts[10];
+	static const int counts[maxTiles];
+	static bool verbose;
 
 	static void createShapes(std::vector<std::vector<bool>> grid, std::vector<std::vector<std::vector<bool>>>* unique, std::vector<std::vector<std::vector<bool>>>* allRots);
 	static std::vector<std::vector<bool>> rotate(std::vector<std::vector<bool>> grid, int r);
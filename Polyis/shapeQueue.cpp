@@ -0,0 +1,27 @@
+#include "shapeQueue.h"
+
+const int ShapeQueue::capacity;
+
+void ShapeQueue::reset(int shapeCount, uint64_t seed, int bagSize) {
+	randomizer.reset(shapeCount, seed, bagSize);
+	head = count = 0;
+}
+
+int ShapeQueue::pop() {
+	int shape = peek(0);
+
+	head = (head + 1) & (capacity - 1);
+	count--;
+	return shape;
+}
+
+/// Shape n places after the next one
+int ShapeQueue::peek(int n) {
+	n = std::min(n, capacity - 1);
+
+	for (; count <= n; count++) {
+		shapes[(head + count) & (capacity - 1)] = randomizer.next();
+	}
+
+	return shapes[(head + n) & (capacity - 1)];
+}
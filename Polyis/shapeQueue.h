@@ -0,0 +1,21 @@
+#pragma once
+
+#include <array>
+
+#include "randomizer.h"
+
+/// Upcoming shapes in a fixed ring buffer. Shapes are only drawn from the randomizer once something looks that far ahead
+class ShapeQueue {
+public:
+	/// Longest preview that can be looked at, must be a power of two
+	static const int capacity = 16;
+
+	void reset(int shapeCount, uint64_t seed, int bagSize = 0);
+	int pop();
+	int peek(int n);
+
+private:
+	std::array<int, capacity> shapes;
+	int head = 0, count = 0;
+	Randomizer randomizer;
+};
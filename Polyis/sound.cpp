@@ -0,0 +1,73 @@
+#include "sound.h"
+
+int Sound::bufferSize = 512;
+Mix_Chunk *Sound::chunks[SOUND_COUNT] = {};
+unsigned int Sound::queued = 0;
+bool Sound::enabled = false;
+int Sound::musicVolume = MIX_MAX_VOLUME;
+int Sound::effectsVolume = MIX_MAX_VOLUME;
+
+bool Sound::open() {
+	if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, bufferSize) != 0) {
+		printf("Error: Failed to initiate Mixer subsystem. SDL_Mixer Error: %s\n", Mix_GetError());
+		return false;
+	}
+
+	Mix_AllocateChannels(SOUND_COUNT); // Channel n only ever plays effect n
+	return true;
+}
+
+void Sound::close() {
+	Mix_HaltChannel(-1);
+
+	for (int n = 0; n < SOUND_COUNT; n++) {
+		Mix_FreeChunk(chunks[n]);
+		chunks[n] = NULL;
+	}
+
+	queued = 0;
+	enabled = false;
+	Mix_CloseAudio();
+}
+
+bool Sound::load(soundEffect effect, SDL_RWops *file, const char *name) {
+	Mix_FreeChunk(chunks[effect]);
+	chunks[effect] = file != NULL ? Mix_LoadWAV_RW(file, 1) : NULL;
+
+	if (chunks[effect] == NULL) {
+		printf("Failed to load sound \"%s\". SDL_Mixer Error: %s\n", name, Mix_GetError());
+		return false;
+	}
+
+	return true;
+}
+
+void Sound::enable() {
+	enabled = true;
+	queued = 0;
+	Mix_VolumeMusic(musicVolume);
+	Mix_Volume(-1, effectsVolume);
+}
+
+void Sound::play(soundEffect effect) {
+	queued |= 1 << effect;
+}
+
+void Sound::flush() {
+	if (queued == 0 || !enabled) return;
+
+	for (int n = 0; n < SOUND_COUNT; n++) {
+		if ((queued >> n) & 1 && chunks[n] != NULL) Mix_PlayChannel(n, chunks[n], 0);
+	}
+
+	queued = 0;
+}
+
+void Sound::setVolume(int master, int music, int effects) {
+	musicVolume = (MIX_MAX_VOLUME * master * music) / 10000;
+	effectsVolume = (MIX_MAX_VOLUME * master * effects) / 10000;
+	if (!enabled) return;
+
+	Mix_VolumeMusic(musicVolume);
+	Mix_Volume(-1, effectsVolume);
+}
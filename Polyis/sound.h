@@ -0,0 +1,43 @@
+#pragma once
+
+#include <SDL.h>
+#include <SDL_mixer.h>
+
+enum soundEffect {
+	SOUND_MOVE,
+	SOUND_ROTATE,
+	SOUND_CLEAR,
+	SOUND_DIFFICULT,
+	SOUND_PLACED,
+	SOUND_GAME_OVER,
+	SOUND_COUNT
+};
+
+/// Sound effects, each decoded once at load and given its own mixer channel (voice)
+class Sound {
+public:
+	/// Samples per mixer callback. Smaller means less delay between a key press and its sound, but more chances of crackling
+	static int bufferSize;
+
+	/// Opening the device and loading can happen on another thread, as long as nothing plays until enable()
+	static bool open();
+	static void close();
+	/// Closes file when done. name is only for error messages
+	static bool load(soundEffect effect, SDL_RWops *file, const char *name);
+	/// Called on the main thread once loading is done. Effects queued before then are dropped
+	static void enable();
+
+	/// Queues the effect for the next flush. An effect queued more than once before then still only starts once
+	static void play(soundEffect effect);
+	/// Starts the queued effects, restarting an effect's voice if it is still playing
+	static void flush();
+
+	/// Percentages, as in the options menu. Set on the mixer as a whole rather than on each chunk, or kept until enable()
+	static void setVolume(int master, int music, int effects);
+
+private:
+	static Mix_Chunk *chunks[SOUND_COUNT];
+	static unsigned int queued;
+	static bool enabled;
+	static int musicVolume, effectsVolume;
+};
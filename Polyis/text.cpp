@@ -1,11 +1,22 @@
-#include "Text.h"
+#include "text.h"
+#include "profiler.h"
 
 SDL_Renderer *Text::renderer = NULL;
 std::string Text::fontPath = "resources/arial.ttf";
+const void *Text::fontData = NULL;
+size_t Text::fontDataSize = 0;
 int Text::defaultSize = 1;
+int Text::frameBudget = 8;
+const int Text::maxFonts;
+std::map<int, Text::cachedFont> Text::fonts;
+unsigned int Text::fontUses = 0;
+int Text::budget = 0;
 
 Text::Text(std::string newText, int size, SDL_Color color) {
 	texture = NULL;
+	width = height = this->size = renderedSize = 0;
+	this->color = {0, 0, 0, 0};
+	dirty = false;
 	text = newText;
 	if (newText == "") return;
 	change(newText, size, color);
@@ -15,23 +26,45 @@ Text::~Text() {
 	if (texture != NULL) SDL_DestroyTexture(texture);
 }
 
-void Text::change(std::string newText, int size, SDL_Color color) {
+/// Only records what the text should look like, it is rasterized the next time it is painted
+void Text::change(std::string newText, int newSize, SDL_Color newColor) {
+	newSize = std::max(13, newSize);
+
+	if ((dirty || renderedSize > 0) && newText == text && newSize == size && newColor.r == color.r && newColor.g == color.g && newColor.b == color.b && newColor.a == color.a) return;
+
 	text = newText;
-	TTF_Font *font = TTF_OpenFont(fontPath.c_str(), std::max(13, size));
+	size = newSize;
+	color = newColor;
+	dirty = true;
+}
+
+void Text::render() {
+	dirty = false;
+	budget--;
 
 	if (texture != NULL) SDL_DestroyTexture(texture);
+	texture = NULL;
+	renderedSize = size;
+
+	if (text == "") return;
 
-	SDL_Surface *surface = TTF_RenderText_Blended(font, newText.c_str(), color);
+	PROFILE_COUNT(rasterizations);
+	SDL_Surface *surface = TTF_RenderText_Blended(getFont(size), text.c_str(), color);
 	texture = SDL_CreateTextureFromSurface(renderer, surface);
 
 	SDL_FreeSurface(surface);
-	TTF_CloseFont(font);
 }
 
 void Text::paint(int x, int y, alignment h, alignment v) {
+	if (dirty && (budget > 0 || texture == NULL)) render();
+
 	SDL_Rect area = {x, y, 0, 0};
 
 	SDL_QueryTexture(texture, NULL, NULL, &area.w, &area.h);
+	if (dirty && renderedSize > 0) { // Stale texture, scale it until there is time to rasterize it again
+		area.w = area.w * size / renderedSize;
+		area.h = area.h * size / renderedSize;
+	}
 	width = area.w;
 	height = area.h;
 
@@ -57,7 +90,7 @@ void Text::paint(int x, int y, alignment h, alignment v) {
 		break;
 	}
 
-	SDL_RenderCopy(renderer, texture, NULL, &area);
+	Profiler::copy(renderer, texture, NULL, &area);
 }
 
 int Text::getWidth() {
@@ -66,4 +99,37 @@ int Text::getWidth() {
 
 int Text::getHeight() {
 	return height;
-}
\ No newline at end of file
+}
+
+void Text::newFrame() {
+	budget = frameBudget;
+}
+
+void Text::closeFonts() {
+	for (auto &font : fonts) {
+		if (font.second.font != NULL) TTF_CloseFont(font.second.font);
+	}
+	fonts.clear();
+}
+
+/// Fonts are only used while rasterizing, so closing one never leaves a text without its font
+TTF_Font *Text::getFont(int size) {
+	auto found = fonts.find(size);
+
+	if (found == fonts.end()) {
+		if (fonts.size() >= maxFonts) {
+			auto oldest = std::min_element(fonts.begin(), fonts.end(), [](const auto &a, const auto &b) { return a.second.lastUse < b.second.lastUse; });
+			if (oldest->second.font != NULL) TTF_CloseFont(oldest->second.font);
+			fonts.erase(oldest);
+		}
+
+		found = fonts.insert({size, {NULL, 0}}).first;
+	}
+
+	TTF_Font *&font = found->second.font;
+	if (font == NULL && fontData != NULL) font = TTF_OpenFontRW(SDL_RWFromConstMem(fontData, (int) fontDataSize), 1, size);
+	else if (font == NULL) font = TTF_OpenFont(fontPath.c_str(), size);
+
+	found->second.lastUse = ++fontUses;
+	return font;
+}
@@ -1,7 +1,10 @@
+#pragma once
+
 #include <SDL.h>
 #include <SDL_ttf.h>
 
 #include <algorithm>
+#include <map>
 #include <string>
 
 enum alignment {
@@ -14,7 +17,12 @@ class Text {
 public:
 	static SDL_Renderer *renderer;
 	static std::string fontPath;
+	/// Font file already in memory (from the resource archive), used instead of fontPath when set
+	static const void *fontData;
+	static size_t fontDataSize;
 	static int defaultSize;
+	/// Most texts rasterized in one frame. Texts past the limit paint their old texture scaled to the new size until a later frame
+	static int frameBudget;
 
 	std::string text;
 
@@ -26,6 +34,27 @@ public:
 	int getHeight();
 	SDL_Texture *texture;
 
+	static void newFrame();
+	static void closeFonts();
+
+	/// Most font sizes kept open. Animations and resizing go through many sizes, the least recently used one is closed to make room
+	static const int maxFonts = 16;
+
 private:
+	struct cachedFont {
+		TTF_Font *font;
+		unsigned int lastUse;
+	};
+
+	static std::map<int, cachedFont> fonts;
+	static unsigned int fontUses;
+	static int budget;
+
 	int width, height;
-};
\ No newline at end of file
+	int size, renderedSize;
+	SDL_Color color;
+	bool dirty;
+
+	void render();
+	static TTF_Font *getFont(int size);
+};
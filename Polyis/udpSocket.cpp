@@ -0,0 +1,170 @@
+#include "udpSocket.h"
+
+#include <cstring>
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+typedef SOCKET socketHandle;
+#else
+typedef int socketHandle;
+#endif
+
+UdpSocket::~UdpSocket() {
+	close();
+}
+
+bool UdpSocket::open(int port) {
+	close();
+
+#ifdef _WIN32
+	static bool started = false;
+	if (!started) {
+		WSADATA data;
+		if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+			printf("Failed to start Winsock\n");
+			return false;
+		}
+		started = true;
+	}
+
+	socketHandle s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (s == INVALID_SOCKET) {
+		printf("Failed to create a UDP socket\n");
+		return false;
+	}
+	u_long nonBlocking = 1;
+	ioctlsocket(s, FIONBIO, &nonBlocking);
+#else
+	socketHandle s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (s < 0) {
+		printf("Failed to create a UDP socket\n");
+		return false;
+	}
+	fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+	handle = (intptr_t) s;
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons((uint16_t) port);
+
+	if (bind(s, (sockaddr*) &address, sizeof(address)) != 0) {
+		printf("Failed to bind UDP port %d\n", port);
+		close();
+		return false;
+	}
+
+	random.seed((unsigned int) std::chrono::steady_clock::now().time_since_epoch().count());
+	return true;
+}
+
+void UdpSocket::close() {
+	if (handle == -1) return;
+
+#ifdef _WIN32
+	closesocket((SOCKET) handle);
+#else
+	::close((int) handle);
+#endif
+	handle = -1;
+	peerKnown = false;
+	held.clear();
+}
+
+bool UdpSocket::setPeer(const char *host, int port) {
+	addrinfo hints = {}, *result = NULL;
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	if (getaddrinfo(host, NULL, &hints, &result) != 0 || result == NULL) {
+		printf("Failed to resolve %s\n", host);
+		return false;
+	}
+
+	peerAddress = ((sockaddr_in*) result->ai_addr)->sin_addr.s_addr;
+	peerPort = htons((uint16_t) port);
+	peerKnown = true;
+	freeaddrinfo(result);
+	return true;
+}
+
+void UdpSocket::send(const void *data, int size) {
+	if (latency == 0 && jitter == 0 && loss == 0.0F) {
+		sendNow(data, size);
+		return;
+	}
+
+	if (std::uniform_real_distribution<float>(0.0F, 1.0F)(random) < loss) return;
+
+	int delay = latency + (jitter > 0 ? std::uniform_int_distribution<int>(0, jitter)(random) : 0);
+	held.push_back({std::chrono::steady_clock::now() + std::chrono::milliseconds(delay), std::vector<uint8_t>((const uint8_t*) data, (const uint8_t*) data + size)});
+	sendDue();
+}
+
+int UdpSocket::receive(void *data, int size) {
+	if (handle == -1) return -1;
+	sendDue();
+
+	while (true) {
+		sockaddr_in from = {};
+		socklen_t fromSize = sizeof(from);
+
+		int received = (int) recvfrom((socketHandle) handle, (char*) data, size, 0, (sockaddr*) &from, &fromSize);
+		if (received < 0) return -1;
+
+		if (!peerKnown) {
+			peerAddress = from.sin_addr.s_addr;
+			peerPort = from.sin_port;
+			peerKnown = true;
+		}
+
+		// Packets from anyone else are dropped once there is a peer
+		if (from.sin_addr.s_addr == peerAddress && from.sin_port == peerPort) return received;
+	}
+}
+
+void UdpSocket::simulate(int newLatency, int newJitter, float newLoss) {
+	latency = newLatency;
+	jitter = newJitter;
+	loss = newLoss;
+}
+
+void UdpSocket::sendNow(const void *data, int size) {
+	if (handle == -1 || !peerKnown) return;
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = peerAddress;
+	address.sin_port = peerPort;
+
+	sendto((socketHandle) handle, (const char*) data, size, 0, (sockaddr*) &address, sizeof(address));
+}
+
+/// Sends the held packets whose delay is up
+void UdpSocket::sendDue() {
+	auto now = std::chrono::steady_clock::now();
+
+	for (int n = 0; n < held.size();) {
+		if (held[n].due <= now) {
+			sendNow(held[n].data.data(), (int) held[n].data.size());
+			held.erase(held.begin() + n);
+		} else {
+			n++;
+		}
+	}
+}
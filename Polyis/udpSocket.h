@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/// Non-blocking UDP socket that talks to one peer.
+/// For testing on one machine it can hold outgoing packets back and drop some of them, like a bad connection would
+class UdpSocket {
+public:
+	~UdpSocket();
+
+	/// Binds to port on every interface, 0 for any free port
+	bool open(int port);
+	void close();
+
+	/// Sends to host:port from now on. Until then replies go to whoever was last heard from
+	bool setPeer(const char *host, int port);
+	bool hasPeer() const { return peerKnown; }
+
+	void send(const void *data, int size);
+	/// Copies the next packet from the peer into data and returns its size, or -1 when there is none
+	int receive(void *data, int size);
+
+	/// Delays outgoing packets by latency milliseconds plus up to jitter more (which reorders them) and drops the fraction loss of them
+	void simulate(int latency, int jitter, float loss);
+
+private:
+	struct heldPacket {
+		std::chrono::steady_clock::time_point due;
+		std::vector<uint8_t> data;
+	};
+
+	intptr_t handle = -1;
+	/// IPv4 address and port in network byte order
+	uint32_t peerAddress = 0;
+	uint16_t peerPort = 0;
+	bool peerKnown = false;
+
+	int latency = 0, jitter = 0;
+	float loss = 0.0F;
+	std::mt19937 random;
+	std::vector<heldPacket> held;
+
+	void sendNow(const void *data, int size);
+	void sendDue();
+};
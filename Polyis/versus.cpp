@@ -0,0 +1,53 @@
+#include <algorithm>
+
+#include "versus.h"
+
+const int Versus::maxPlayers;
+
+/// The games are only allocated here, so pointers to them stay valid until the next begin
+void Versus::begin(int players, const gameSettings &settings, uint64_t seed) {
+	games.resize(std::max(2, std::min(maxPlayers, players)));
+
+	for (int n = 0; n < games.size(); n++) {
+		games[n].begin(settings, seed);
+	}
+}
+
+void Versus::update() {
+	for (int n = 0; n < games.size(); n++) {
+		games[n].update();
+	}
+
+	// Garbage moves after every board has ticked, so the order boards are updated in doesn't matter
+	for (int n = 0; n < games.size(); n++) {
+		unsigned int rows = games[n].takeGarbage();
+		int to = target(n);
+		if (rows > 0 && to >= 0) games[to].addGarbage(rows);
+	}
+}
+
+int Versus::playing() const {
+	int count = 0;
+	for (int n = 0; n < games.size(); n++) {
+		if (!games[n].ended) count++;
+	}
+	return count;
+}
+
+int Versus::winner() const {
+	if (playing() != 1) return -1;
+
+	for (int n = 0; n < games.size(); n++) {
+		if (!games[n].ended) return n;
+	}
+	return -1;
+}
+
+/// Next board after from that is still playing, wrapping around
+int Versus::target(int from) const {
+	for (int step = 1; step < games.size(); step++) {
+		int n = (from + step) % games.size();
+		if (!games[n].ended) return n;
+	}
+	return -1;
+}
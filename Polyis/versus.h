@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "game.h"
+
+/// Several games played in lockstep: every board ticks once per update, then the garbage each one cleared goes to the next board still playing.
+/// Every game gets the same seed, so all players see the same shapes and the same garbage holes
+class Versus {
+public:
+	static const int maxPlayers = 8;
+
+	std::vector<Game> games;
+
+	void begin(int players, const gameSettings &settings, uint64_t seed);
+	/// Advances every board by one tick
+	void update();
+
+	/// Boards that haven't topped out
+	int playing() const;
+	/// Last board standing once every other one has topped out, otherwise -1
+	int winner() const;
+
+private:
+	int target(int from) const;
+};
@@ -0,0 +1,304 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+
+#include "board.h"
+#include "bot.h"
+#include "game.h"
+#include "shape.h"
+#include "shapeFinder.h"
+#include "shapeQueue.h"
+#include "versus.h"
+
+/// Every benchmark reports heap allocations per iteration next to its time
+static std::atomic<long> allocations(0);
+
+void *operator new(size_t size) {
+	allocations++;
+
+	void *p = malloc(size ? size : 1);
+	if (p == NULL) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) noexcept {
+	free(p);
+}
+
+class AllocationCounter {
+public:
+	AllocationCounter(benchmark::State &state) : state(state), start(allocations) {}
+	~AllocationCounter() { state.counters["allocs"] = benchmark::Counter((double) (allocations - start), benchmark::Counter::kAvgIterations); }
+
+private:
+	benchmark::State &state;
+	long start;
+};
+
+/// Board sizes the fixtures are built with, from the standard playfield up to the largest custom grid
+static void boardSizes(benchmark::internal::Benchmark *b) {
+	b->Args({10, 22})->Args({40, 40})->Args({100, 100})->Args({255, 255});
+}
+
+/// Bottom half of the board filled with random cells (fixed seed) and about one hole per row so nothing clears
+static Board makeBoard(int width, int height) {
+	Board grid(width, height);
+	std::mt19937 random(1234);
+
+	for (int y = height / 2; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			grid[y][x] = random() % 4 == 0 ? 0 : 1 + random() % 7;
+		}
+		grid[y][random() % width] = 0;
+	}
+
+	return grid;
+}
+
+/// Shape in open space at the top middle of the board
+static Shape makeShape(const Board &grid, int index) {
+	Shape shape(index);
+	shape.x = grid.width / 2 - 2;
+	shape.y = 0;
+	return shape;
+}
+
+static void setUp() {
+	Shape::tiles = 4;
+	Shape::init();
+}
+
+static void BM_ShapeMove(benchmark::State &state) {
+	setUp();
+	Board grid = makeBoard(state.range(0), state.range(1));
+	Shape shape = makeShape(grid, 5);
+	AllocationCounter counter(state);
+
+	bool right = true;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(shape.move(grid, right));
+		right = !right;
+	}
+}
+BENCHMARK(BM_ShapeMove)->Apply(boardSizes);
+
+static void BM_ShapeFall(benchmark::State &state) {
+	setUp();
+	Board grid = makeBoard(state.range(0), state.range(1));
+	Shape shape = makeShape(grid, 5);
+	AllocationCounter counter(state);
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(shape.fall(grid, false));
+	}
+}
+BENCHMARK(BM_ShapeFall)->Apply(boardSizes);
+
+static void BM_ShapeRotate(benchmark::State &state) {
+	setUp();
+	Board grid = makeBoard(state.range(0), state.range(1));
+	Shape shape = makeShape(grid, 5);
+	AllocationCounter counter(state);
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(shape.rotate(grid, true));
+	}
+}
+BENCHMARK(BM_ShapeRotate)->Apply(boardSizes);
+
+/// A vertical I against the left wall, turning it flat has to search the kick table
+static void BM_ShapeWallKick(benchmark::State &state) {
+	setUp();
+	Board grid = makeBoard(state.range(0), state.range(1));
+	AllocationCounter counter(state);
+
+	for (auto _ : state) {
+		Shape shape(0);
+		shape.rotation = 1;
+		shape.x = -2;
+		benchmark::DoNotOptimize(shape.rotate(grid, true));
+	}
+}
+BENCHMARK(BM_ShapeWallKick)->Apply(boardSizes);
+
+static void BM_GhostLandingY(benchmark::State &state) {
+	setUp();
+	Board grid = makeBoard(state.range(0), state.range(1));
+	Shape shape = makeShape(grid, 5);
+	AllocationCounter counter(state);
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(shape.landingY(grid));
+	}
+}
+BENCHMARK(BM_GhostLandingY)->Apply(boardSizes);
+
+/// Placing a vertical I into a well in the bottom four full rows, then clearing them like addShape does
+static void BM_LineClear(benchmark::State &state) {
+	setUp();
+	Board start = makeBoard(state.range(0), state.range(1));
+	int well = start.width / 2;
+
+	for (int y = start.height - 4; y < start.height; y++) {
+		for (int x = 0; x < start.width; x++) {
+			start[y][x] = x == well ? 0 : 1;
+		}
+	}
+
+	Shape shape(0);
+	shape.rotation = 1;
+	shape.x = well - 2;
+	shape.y = start.height - 4;
+
+	Board grid = start;
+	AllocationCounter counter(state);
+
+	for (auto _ : state) {
+		state.PauseTiming();
+		memcpy(grid.cells.data(), start.cells.data(), start.cells.size());
+		state.ResumeTiming();
+
+		const gridArray &data = shape.data();
+		for (int x = 0; x < data.size(); x++) {
+			for (int y = 0; y < data.size(); y++) {
+				if (data[y][x]) grid[shape.y + y][shape.x + x] = data[y][x];
+			}
+		}
+
+		benchmark::DoNotOptimize(grid.clearLines());
+	}
+}
+BENCHMARK(BM_LineClear)->Apply(boardSizes);
+
+/// Flood fill gravity after a clear, the custom game mode with the most work per placed shape
+static void BM_BoardSettle(benchmark::State &state) {
+	Board start = makeBoard(state.range(0), state.range(1));
+	Board grid = start;
+	AllocationCounter counter(state);
+
+	for (auto _ : state) {
+		state.PauseTiming();
+		memcpy(grid.cells.data(), start.cells.data(), start.cells.size());
+		state.ResumeTiming();
+
+		benchmark::DoNotOptimize(grid.settle());
+	}
+}
+BENCHMARK(BM_BoardSettle)->Apply(boardSizes);
+
+static void BM_ShapeQueuePop(benchmark::State &state) {
+	ShapeQueue queue;
+	queue.reset(state.range(0), 1234, state.range(0) > Randomizer::largeSetBag ? Randomizer::largeSetBag : 0);
+	AllocationCounter counter(state);
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(queue.pop());
+		benchmark::DoNotOptimize(queue.peek(4));
+	}
+}
+BENCHMARK(BM_ShapeQueuePop)->Arg(7)->Arg(9189);
+
+/// A standard game played by the bot for a minute of game time, the whole rules loop the way a replay runs it
+static void BM_BotGame(benchmark::State &state) {
+	setUp();
+	Game game;
+	AllocationCounter counter(state);
+
+	for (auto _ : state) {
+		Bot bot;
+		game.begin(gameSettings(), 1234);
+
+		while (!game.ended && game.ticks < 120 * 60) {
+			int input = bot.next(game);
+			if (input >= 0) game.input((gameInput) input);
+			game.update();
+		}
+
+		benchmark::DoNotOptimize(game.score);
+	}
+}
+BENCHMARK(BM_BotGame)->Unit(benchmark::kMillisecond);
+
+/// Bots playing each other for a minute of game time, garbage and all. Divide by players for the cost of one board
+static void BM_VersusGame(benchmark::State &state) {
+	setUp();
+	Versus versus;
+	AllocationCounter counter(state);
+
+	for (auto _ : state) {
+		versus.begin(state.range(0), gameSettings(), 1234);
+		std::vector<Bot> bots(versus.games.size());
+
+		for (int tick = 0; versus.playing() > 1 && tick < 120 * 60; tick++) {
+			for (int n = 0; n < versus.games.size(); n++) {
+				int input = bots[n].next(versus.games[n]);
+				if (input >= 0) versus.games[n].input((gameInput) input);
+			}
+			versus.update();
+		}
+
+		benchmark::DoNotOptimize(versus.games[0].score);
+	}
+}
+BENCHMARK(BM_VersusGame)->Arg(2)->Arg(8)->Unit(benchmark::kMillisecond);
+
+/// A netplay rollback: two boards put back to a saved tick and simulated forward again. Both have to fit in a small part of a frame
+static void BM_Rollback(benchmark::State &state) {
+	setUp();
+	Versus saved, current;
+	saved.begin(2, gameSettings(), 1234);
+	std::vector<Bot> bots(2);
+
+	for (int tick = 0; tick < 120 * 10; tick++) { // Some shapes on the boards first
+		for (int n = 0; n < 2; n++) {
+			int input = bots[n].next(saved.games[n]);
+			if (input >= 0) saved.games[n].input((gameInput) input);
+		}
+		saved.update();
+	}
+	current = saved;
+
+	AllocationCounter counter(state);
+
+	for (auto _ : state) {
+		current = saved;
+		for (int tick = 0; tick < state.range(0); tick++) current.update();
+		benchmark::DoNotOptimize(current.games[0].score);
+	}
+}
+BENCHMARK(BM_Rollback)->Arg(8)->Arg(16);
+
+static void BM_ShapeFinder(benchmark::State &state) {
+	AllocationCounter counter(state);
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(ShapeFinder::find(state.range(0)).size());
+	}
+}
+
+/// ShapeFinder takes seconds at 8 tiles and grows about 30x per tile after that, so larger sizes only run when asked for with --shapefinder_max_tiles=N
+int main(int argc, char **argv) {
+	int maxTiles = 8;
+
+	for (int i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--shapefinder_max_tiles=", 24) == 0) {
+			maxTiles = std::min(ShapeFinder::maxTiles, std::max(1, atoi(argv[i] + 24)));
+			for (int j = i; j < argc - 1; j++) argv[j] = argv[j + 1];
+			argc--;
+			break;
+		}
+	}
+
+	benchmark::RegisterBenchmark("BM_ShapeFinder", BM_ShapeFinder)->DenseRange(1, maxTiles)->Unit(benchmark::kMillisecond);
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
@@ -0,0 +1,40 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "text.h"
+
+/// Software renderer drawing into a surface, so text is rasterized and uploaded for real without a window
+static SDL_Renderer *textRenderer() {
+	static SDL_Renderer *renderer = NULL;
+
+	if (renderer == NULL) {
+		TTF_Init();
+		SDL_Surface *target = SDL_CreateRGBSurfaceWithFormat(0, 640, 480, 32, SDL_PIXELFORMAT_ARGB8888);
+		renderer = SDL_CreateSoftwareRenderer(target);
+
+		Text::renderer = renderer;
+		Text::fontPath = POLYIS_BENCH_FONT;
+	}
+
+	return renderer;
+}
+
+/// What score and line counters pay every frame: change, then paint, which rasterizes the text when it changed.
+/// With one value the text never changes and this is just the cached texture being drawn
+static void BM_TextChange(benchmark::State &state) {
+	if (textRenderer() == NULL) {
+		state.SkipWithError("No software renderer");
+		return;
+	}
+
+	Text text("0", 20);
+	int value = 0;
+
+	for (auto _ : state) {
+		Text::newFrame();
+		text.change(std::to_string(value++ % state.range(0)), 20);
+		text.paint(0, 0);
+	}
+}
+BENCHMARK(BM_TextChange)->Arg(1)->Arg(1000000);
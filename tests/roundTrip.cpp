@@ -0,0 +1,154 @@
+#include <cstring>
+#include <filesystem>
+#include <stdio.h>
+#include <string>
+
+#include "highScores.h"
+#include "settings.h"
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+	if (!condition) {
+		printf("FAILED: %s\n", what);
+		failures++;
+	}
+}
+
+/// Values survive a save and load, and lines that don't fit their key are skipped on load
+static void settingsRoundTrip(const std::string &directory) {
+	std::string path = directory + "/settings";
+	std::filesystem::remove(path);
+
+	int volume = 35, width = 120, gravity = -2;
+	Settings saved;
+	saved.add("volume", &volume, 0, 100);
+	saved.add("width", &width, 4, 255);
+	saved.add("gravity", &gravity, -3, 4);
+	check(saved.save(path.c_str()), "settings save");
+
+	int loadedVolume = 0, loadedWidth = 0, loadedGravity = 0;
+	Settings loaded;
+	loaded.add("volume", &loadedVolume, 0, 100);
+	loaded.add("width", &loadedWidth, 4, 255);
+	loaded.add("gravity", &loadedGravity, -3, 4);
+	check(loaded.load(path.c_str()), "settings load");
+	check(loadedVolume == 35 && loadedWidth == 120 && loadedGravity == -2, "settings keep their values");
+
+	FILE *file = fopen(path.c_str(), "wb");
+	fputs("volume=250\nwidth=12x\nunknown=3\ngravity=4\n", file);
+	fclose(file);
+
+	loadedVolume = loadedWidth = 7;
+	check(loaded.load(path.c_str()), "settings load with bad lines");
+	check(loadedVolume == 7 && loadedWidth == 7 && loadedGravity == 4, "bad settings lines are skipped");
+}
+
+static void addScore(HighScores &scores, uint64_t mode, unsigned int score) {
+	Game game;
+	game.score = score;
+	game.lines = score / 100;
+	scores.add(mode, "p" + std::to_string(score), game);
+}
+
+/// Scores are written on the writer thread and read back best first, and a record cut off halfway is dropped on load
+static void scoreLogRoundTrip(const std::string &directory) {
+	std::string path = directory + "/scores.log";
+	std::filesystem::remove(path);
+
+	uint64_t mode = HighScores::standardMode(3), custom = HighScores::customMode(gameSettings());
+	{
+		HighScores scores;
+		scores.load(path.c_str());
+		for (unsigned int n = 1; n <= HighScores::topCount + 5; n++) addScore(scores, mode, n * 1000);
+		addScore(scores, custom, 42);
+		scores.close();
+	}
+
+	uintmax_t size = std::filesystem::file_size(path);
+	FILE *file = fopen(path.c_str(), "ab");
+	fwrite("partial record", 1, 14, file);
+	fclose(file);
+
+	HighScores scores;
+	check(scores.load(path.c_str()), "score log load");
+
+	const std::vector<scoreRecord> &top = scores.top(mode);
+	check(top.size() == HighScores::topCount, "top list is full");
+	check(!top.empty() && top[0].score == (HighScores::topCount + 5) * 1000 && strcmp(top[0].name, "p15000") == 0, "best score comes first");
+	check(!top.empty() && top.back().score == 6000, "lowest kept score");
+	check(scores.top(custom).size() == 1 && scores.top(custom)[0].score == 42, "custom mode score");
+	check(std::filesystem::file_size(path) == size, "partial record is cut off");
+	scores.close();
+}
+
+/// A log whose header never made it to disk is started over instead of refused, so later scores are still saved
+static void unfinishedScoreLog(const std::string &directory) {
+	std::string path = directory + "/unfinished.log";
+	uint64_t mode = HighScores::standardMode(1);
+
+	for (size_t size : {0, 3}) {
+		FILE *file = fopen(path.c_str(), "wb");
+		fwrite("PLYS", 1, size, file);
+		fclose(file);
+
+		{
+			HighScores scores;
+			check(scores.load(path.c_str()), "unfinished score log load");
+			addScore(scores, mode, 500);
+			scores.close();
+		}
+
+		HighScores scores;
+		check(scores.load(path.c_str()), "restarted score log load");
+		check(scores.top(mode).size() == 1 && scores.top(mode)[0].score == 500, "score saved to a restarted log");
+		scores.close();
+	}
+}
+
+/// Compacting the score log down to the top lists leaves every game in the stats log, and a stats record cut off halfway is dropped on load
+static void statsLogKeepsEveryGame(const std::string &directory) {
+	std::string path = directory + "/compacted.log", statsPath = directory + "/stats.log";
+	std::filesystem::remove(path);
+	std::filesystem::remove(statsPath);
+
+	uint64_t mode = HighScores::standardMode(2);
+	const int games = 200;
+	{
+		HighScores scores;
+		scores.load(path.c_str(), statsPath.c_str());
+		for (unsigned int n = 1; n <= games; n++) addScore(scores, mode, n);
+		scores.close();
+	}
+
+	uintmax_t statsSize = std::filesystem::file_size(statsPath);
+	check(std::filesystem::file_size(path) < games * sizeof(scoreRecord), "score log is compacted");
+	check(statsSize == 8 + games * sizeof(scoreRecord), "stats log has every game");
+
+	FILE *file = fopen(statsPath.c_str(), "ab");
+	fwrite("partial record", 1, 14, file);
+	fclose(file);
+
+	HighScores scores;
+	check(scores.load(path.c_str(), statsPath.c_str()), "score log load after compacting");
+	check(scores.top(mode).size() == HighScores::topCount && scores.top(mode)[0].score == games, "compacted top list");
+	check(std::filesystem::file_size(statsPath) == statsSize, "partial stats record is cut off");
+	scores.close();
+}
+
+/// Writes settings and a score log into directory, reads them back and checks nothing changed on the way
+int main(int argc, char *argv[]) {
+	if (argc != 2) {
+		printf("Usage: %s directory\n", argv[0]);
+		return 1;
+	}
+
+	std::filesystem::create_directories(argv[1]);
+	settingsRoundTrip(argv[1]);
+	scoreLogRoundTrip(argv[1]);
+	unfinishedScoreLog(argv[1]);
+	statsLogKeepsEveryGame(argv[1]);
+
+	printf("%s\n", failures == 0 ? "Settings and score log round trip passed" : "Round trip failed");
+	return failures == 0 ? 0 : 1;
+}
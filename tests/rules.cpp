@@ -0,0 +1,97 @@
+#include <stdio.h>
+
+#include "game.h"
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+	if (!condition) {
+		printf("FAILED: %s\n", what);
+		failures++;
+	}
+}
+
+/// Fills every cell inside the grid shape except column 0 and the current shape, so nothing clears and the next spawn tops out
+static void fillBoard(Game &game) {
+	for (int y = 0; y < game.grid.height; y++) {
+		for (int x = 1; x < game.grid.width; x++) {
+			int sx = x - game.currentShape.x, sy = y - game.currentShape.y;
+			int size = (int) game.currentShape.data().size();
+			bool covered = sx >= 0 && sy >= 0 && sx < size && sy < size && game.currentShape.data()[sy][sx];
+			if (game.grid[y][x] == 0 && !covered) game.grid[y][x] = 1;
+		}
+	}
+}
+
+static void lock(Game &game) {
+	game.hardDrop();
+	game.update();
+}
+
+/// Losing a life goes back to the spawn of the shape taken out by the first hold, with the held shape still held
+static void holdSurvivesRewind() {
+	gameSettings settings;
+	settings.lives = 1;
+
+	Game game;
+	game.begin(settings, 7);
+	int held = game.currentShape.index;
+	game.hold();
+	int spawned = game.currentShape.index;
+
+	fillBoard(game);
+	lock(game);
+	check(game.lives == 0 && !game.ended, "first hold: top out costs a life");
+	check(game.heldIndex == held, "first hold: held shape survives the rewind");
+	check(game.currentShape.index == spawned, "first hold: rewinds to the spawned shape");
+	check(!game.canHold, "first hold: holding stays used up");
+}
+
+/// A swap that tops out rewinds to the spawn of the shape before it, where holding is still allowed
+static void swapRewind() {
+	gameSettings settings;
+	settings.lives = 1;
+
+	Game game;
+	game.begin(settings, 7);
+	game.hold();
+	int held = game.heldIndex;
+	lock(game);
+	int current = game.currentShape.index;
+
+	fillBoard(game);
+	game.hold();
+	check(game.lives == 0 && !game.ended, "swap: top out costs a life");
+	check(game.heldIndex == held && game.currentShape.index == current, "swap: rewinds to before the swap");
+	check(game.canHold, "swap: holding is allowed again after the rewind");
+}
+
+/// Garbage rows on a masked grid get their hole inside the grid shape, so they can't clear without the hole being filled
+static void garbageHolesInsideMask() {
+	for (uint64_t hole = 0; hole < 24; hole++) {
+		Board grid(24, 26, CIRCLE);
+		grid.addGarbage(4, hole);
+
+		bool holed = true;
+		for (int y = grid.height - 4; y < grid.height; y++) {
+			int holes = 0;
+			for (int x = 0; x < grid.width; x++) holes += grid.inMask(x, y) && grid[y][x] == 0;
+			holed = holed && holes == 1;
+		}
+
+		check(holed, "garbage: every row has one hole inside the grid shape");
+		check(grid.clearLines() == 0, "garbage: rows with a hole don't clear");
+	}
+}
+
+/// Plays out game rules that only show up in rare situations, like losing a life right after holding
+int main() {
+	Shape::init();
+
+	holdSurvivesRewind();
+	swapRewind();
+	garbageHolesInsideMask();
+
+	printf("%s\n", failures == 0 ? "Game rules passed" : "Game rules failed");
+	return failures == 0 ? 0 : 1;
+}
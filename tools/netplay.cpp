@@ -0,0 +1,112 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <stdio.h>
+#include <thread>
+
+#include "bot.h"
+#include "netplay.h"
+
+/// Ticks one peer at the game's own rate, its bot pressing the keys, until both peers have every input up to ticks
+/// (or the other one has gone quiet for a second after that). False if nothing moved for 10 seconds
+static bool play(Netplay &netplay, unsigned int ticks) {
+	Bot bot;
+	auto start = std::chrono::steady_clock::now(), lastTick = start, lastHeard = start;
+	unsigned int heardTick = 0;
+
+	while (true) {
+		auto now = std::chrono::steady_clock::now();
+
+		netplay.poll();
+
+		if (netplay.started && netplay.tick() < ticks && now - lastTick >= std::chrono::duration<double>(Game::tickLength)) {
+			lastTick += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(Game::tickLength));
+			if (now - lastTick > std::chrono::milliseconds(250)) lastTick = now; // Don't try to catch up after a long stall
+
+			const Game &game = netplay.current.games[netplay.player];
+			int input = bot.next(game);
+			if (input >= 0) netplay.input((gameInput) input);
+			netplay.update();
+		}
+
+		if (netplay.confirmedTicks() != heardTick) {
+			heardTick = netplay.confirmedTicks();
+			lastHeard = now;
+		}
+
+		if (netplay.confirmedTicks() >= ticks && (netplay.acknowledged() >= ticks || now - lastHeard > std::chrono::seconds(1))) break;
+		if (now - lastHeard > std::chrono::seconds(10)) {
+			printf("Netplay: gave up after 10 seconds without progress at tick %u\n", netplay.confirmedTicks());
+			return false;
+		}
+
+		std::this_thread::sleep_for(std::chrono::microseconds(500));
+	}
+
+	float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+	printf("Player %d: %u ticks in %.1fs, checksum %016llx, scores %u and %u\n", netplay.player + 1, netplay.confirmedTicks(), seconds, (unsigned long long) netplay.checksum(), netplay.current.games[0].score, netplay.current.games[1].score);
+	printf("Player %d: %u rollbacks, %.1f ticks on average and %u at most, %.1fus each, %u stalls\n", netplay.player + 1, netplay.rollbacks, netplay.rollbacks ? (float) netplay.rolledBackTicks / netplay.rollbacks : 0.0F, netplay.maxRolledBackTicks, netplay.rollbacks ? netplay.rollbackSeconds * 1e6 / netplay.rollbacks : 0.0, netplay.stalls);
+	return true;
+}
+
+/// Plays a networked versus game between two bots in real time and prints a checksum of the boards at the end.
+/// Run a --host and a --join side by side, matching checksums mean both peers simulated the same game through every rollback.
+/// --loopback port runs both peers in this process on localhost and fails unless the checksums match
+int main(int argc, char *argv[]) {
+	int hostPort = 0, joinPort = 0, loopbackPort = 0, latency = 0, jitter = 0;
+	const char *address = NULL;
+	float loss = 0.0F;
+	unsigned int delay = 2, ticks = 120 * 60;
+	bool valid = true;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) hostPort = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--join") == 0 && i + 2 < argc) {
+			address = argv[++i];
+			joinPort = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--loopback") == 0 && i + 1 < argc) loopbackPort = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--delay") == 0 && i + 1 < argc) delay = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) latency = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--jitter") == 0 && i + 1 < argc) jitter = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc) loss = (float) atof(argv[++i]) / 100;
+		else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) ticks = atoi(argv[++i]);
+		else valid = false;
+	}
+
+	if (!valid || (hostPort != 0) + (joinPort != 0) + (loopbackPort != 0) != 1) {
+		printf("Usage: %s (--host port | --join address port | --loopback port) [--delay ticks] [--latency ms] [--jitter ms] [--loss percent] [--ticks count]\n", argv[0]);
+		return 1;
+	}
+
+	Shape::init();
+
+	if (loopbackPort != 0) {
+		Netplay peers[2];
+		bool played[2] = {false, false};
+
+		for (int n = 0; n < 2; n++) {
+			peers[n].inputDelay = delay;
+			peers[n].socket.simulate(latency, jitter, loss);
+		}
+		if (!peers[0].host(loopbackPort, gameSettings(), 1234) || !peers[1].join("127.0.0.1", loopbackPort)) return 1;
+
+		std::thread joiner([&]() { played[1] = play(peers[1], ticks); });
+		played[0] = play(peers[0], ticks);
+		joiner.join();
+
+		if (!played[0] || !played[1]) return 1;
+		if (peers[0].checksum() != peers[1].checksum()) {
+			printf("Netplay: the peers went out of sync\n");
+			return 1;
+		}
+		return 0;
+	}
+
+	Netplay netplay;
+	netplay.inputDelay = delay;
+	netplay.socket.simulate(latency, jitter, loss);
+	if (hostPort != 0 ? !netplay.host(hostPort, gameSettings(), 1234) : !netplay.join(address, joinPort)) return 1;
+
+	return play(netplay, ticks) ? 0 : 1;
+}
@@ -0,0 +1,79 @@
+#include <cstring>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "archive.h"
+
+static bool readFile(const char *path, std::vector<uint8_t> &contents) {
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) return false;
+
+	contents.clear();
+	uint8_t buffer[65536];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) contents.insert(contents.end(), buffer, buffer + read);
+
+	bool valid = ferror(file) == 0;
+	fclose(file);
+	return valid;
+}
+
+/// Packs files into a resource archive, each under its file name without the directory
+int main(int argc, char *argv[]) {
+	bool compressWav = false;
+	int first = 1;
+
+	if (first < argc && strcmp(argv[first], "--compress") == 0) {
+		compressWav = true;
+		first++;
+	}
+
+	if (argc - first < 2) {
+		printf("Usage: %s [--compress] archive files\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<archiveFile> files;
+	size_t total = 0;
+
+	for (int i = first + 1; i < argc; i++) {
+		archiveFile file;
+		std::string path = argv[i];
+		size_t slash = path.find_last_of("/\\");
+		file.name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+		if (!readFile(argv[i], file.contents)) {
+			printf("Error: Failed to read \"%s\"\n", argv[i]);
+			return 1;
+		}
+
+		total += file.contents.size();
+		files.push_back(file);
+	}
+
+	if (!Archive::write(argv[first], files, compressWav)) return 1;
+
+	Archive archive;
+	if (!archive.open(argv[first])) return 1;
+
+	size_t packed = 0;
+	for (int i = 0; i < files.size(); i++) {
+		size_t size = 0;
+		const uint8_t *data = archive.find(files[i].name.c_str(), size);
+		if (data == NULL || size != files[i].contents.size() || memcmp(data, files[i].contents.data(), size) != 0) {
+			printf("Error: \"%s\" does not read back the same from the archive\n", files[i].name.c_str());
+			return 1;
+		}
+	}
+
+	FILE *out = fopen(argv[first], "rb");
+	if (out != NULL) {
+		fseek(out, 0, SEEK_END);
+		packed = ftell(out);
+		fclose(out);
+	}
+
+	printf("%i files, %zu bytes packed into %zu\n", (int) files.size(), total, packed);
+	return 0;
+}
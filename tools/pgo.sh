@@ -0,0 +1,54 @@
+#!/bin/sh
+# Profile guided build: builds polyis instrumented, replays the recorded games in replays/ plus some bot games
+# headlessly to collect a profile, rebuilds with it and compares the result against a plain release build.
+#
+# Usage: tools/pgo.sh [cmake options...]
+# BUILD (default build-pgo), CORPUS (default replays) and BOT_GAMES (default 10) can be set in the environment.
+set -e
+
+SOURCE=$(cd "$(dirname "$0")/.." && pwd)
+BUILD=${BUILD:-$SOURCE/build-pgo}
+CORPUS=${CORPUS:-$SOURCE/replays}
+BOT_GAMES=${BOT_GAMES:-10}
+PROFILE=$BUILD/profile
+JOBS=$(nproc 2>/dev/null || echo 4)
+
+replays=$(ls "$CORPUS"/*.replay 2>/dev/null || true)
+
+echo "== Plain release build"
+cmake -S "$SOURCE" -B "$BUILD/plain" -DCMAKE_BUILD_TYPE=Release -DPOLYIS_PGO=OFF "$@" > /dev/null
+cmake --build "$BUILD/plain" -j "$JOBS"
+
+# GCC looks profiles up by object path, so the instrumented and optimized builds share a build directory
+echo "== Instrumented build"
+rm -rf "$PROFILE"
+cmake -S "$SOURCE" -B "$BUILD/pgo" -DCMAKE_BUILD_TYPE=Release -DPOLYIS_PGO=GENERATE -DPOLYIS_PGO_DIR="$PROFILE" "$@" > /dev/null
+cmake --build "$BUILD/pgo" -j "$JOBS"
+
+echo "== Collecting the profile from $(echo $replays | wc -w) replays and $BOT_GAMES bot games"
+"$BUILD/pgo/polyis-replay" --quiet --bot "$BOT_GAMES" $replays
+
+if ls "$PROFILE"/*.profraw > /dev/null 2>&1; then # Clang writes raw profiles that have to be merged first
+	llvm-profdata merge -output="$PROFILE/polyis.profdata" "$PROFILE"/*.profraw
+fi
+
+echo "== Optimized build"
+cmake -S "$SOURCE" -B "$BUILD/pgo" -DPOLYIS_PGO=USE > /dev/null
+cmake --build "$BUILD/pgo" -j "$JOBS" --clean-first
+
+echo "== Replay throughput"
+plain=$("$BUILD/plain/polyis-replay" --quiet --bot "$BOT_GAMES" $replays | tail -n 1)
+optimized=$("$BUILD/pgo/polyis-replay" --quiet --bot "$BOT_GAMES" $replays | tail -n 1)
+echo "plain:     $plain"
+echo "optimized: $optimized"
+echo "$plain $optimized" | sed 's/[()]//g' | awk '{ printf "speedup:   %.2fx\n", $(NF - 1) / $((NF / 2) - 1) }'
+
+if [ -x "$BUILD/plain/bench/polyis-bench" ]; then
+	echo "== Benchmarks"
+	"$BUILD/plain/bench/polyis-bench" --benchmark_format=csv > "$BUILD/plain.csv" 2> /dev/null
+	"$BUILD/pgo/bench/polyis-bench" --benchmark_format=csv > "$BUILD/pgo.csv" 2> /dev/null
+	# Columns are name,iterations,real_time,cpu_time,...
+	awk -F, 'NR == FNR { if (FNR > 1) time[$1] = $4; next }
+		FNR > 1 && ($1 in time) { printf "%-32s %12.1f %12.1f %6.2fx\n", $1, time[$1], $4, time[$1] / $4 }' \
+		"$BUILD/plain.csv" "$BUILD/pgo.csv"
+fi
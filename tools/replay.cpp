@@ -0,0 +1,103 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "bot.h"
+#include "game.h"
+#include "replay.h"
+
+/// Longest bot game, ten minutes of play
+static const unsigned int maxBotTicks = 120 * 60 * 10;
+
+/// Settings the bot games cycle through, so custom boards and flood fill show up in profiles too
+static std::vector<gameSettings> botSettings() {
+	std::vector<gameSettings> list(5);
+
+	list[1].startingLevel = 8;
+
+	list[2].floodFill = true;
+	list[2].width = 16;
+	list[2].height = 30;
+
+	list[3].shape = CIRCLE;
+	list[3].width = 24;
+	list[3].height = 26;
+
+	list[4].width = 60;
+	list[4].height = 80;
+
+	return list;
+}
+
+/// Plays recorded games and bot games headlessly. Used to check replays still play back the same and to gather profiles for PGO builds
+int main(int argc, char *argv[]) {
+	int botGames = 0;
+	const char *recordDirectory = NULL;
+	bool quiet = false;
+	std::vector<const char*> files;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--bot") == 0 && i + 1 < argc) botGames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordDirectory = argv[++i];
+		else if (strcmp(argv[i], "--quiet") == 0) quiet = true;
+		else if (argv[i][0] == '-') {
+			printf("Usage: %s [--bot games] [--record directory] [--quiet] [replay files...]\n", argv[0]);
+			return 1;
+		} else files.push_back(argv[i]);
+	}
+
+	Shape::init();
+
+	Game game;
+	Replay replay;
+	unsigned long totalTicks = 0;
+	int mismatches = 0;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < files.size(); i++) {
+		if (!replay.load(files[i])) {
+			mismatches++;
+			continue;
+		}
+
+		bool same = replay.play(game);
+		totalTicks += game.ticks;
+
+		if (!same) mismatches++;
+		if (!quiet || !same) printf("%s: score %u, lines %u, %u ticks%s\n", files[i], game.score, game.lines, game.ticks, same ? "" : " (DIFFERENT FROM RECORDING)");
+	}
+
+	std::vector<gameSettings> settings = botSettings();
+
+	for (int i = 0; i < botGames; i++) {
+		Bot bot;
+
+		replay.start(settings[i % settings.size()], i + 1);
+		game.recording = recordDirectory != NULL ? &replay : NULL;
+		game.begin(replay.settings, replay.seed);
+
+		while (!game.ended && game.ticks < maxBotTicks) {
+			int input = bot.next(game);
+			if (input >= 0) game.input((gameInput) input);
+			game.update();
+		}
+
+		totalTicks += game.ticks;
+		if (!quiet) printf("bot %i: score %u, lines %u, %u ticks\n", i + 1, game.score, game.lines, game.ticks);
+
+		if (recordDirectory != NULL) {
+			replay.finish(game);
+			replay.save((std::string(recordDirectory) + "/bot-" + std::to_string(i + 1) + ".replay").c_str());
+			game.recording = NULL;
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%i games, %lu ticks in %.3fs (%.0f ticks/s)\n", (int) files.size() + botGames, totalTicks, seconds, totalTicks / seconds);
+
+	return mismatches > 0 ? 1 : 0;
+}
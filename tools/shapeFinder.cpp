@@ -0,0 +1,15 @@
+#include <cstdlib>
+#include <stdio.h>
+
+#include "shapeFinder.h"
+
+/// Prints every shape with the given number of tiles
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		printf("Usage: %s tiles (1 to %i)\n", argv[0], ShapeFinder::maxTiles);
+		return 1;
+	}
+
+	ShapeFinder::start(atoi(argv[1]));
+	return 0;
+}